@@ -0,0 +1,136 @@
+#ifndef __async_Serialization_HEADER__
+#define __async_Serialization_HEADER__
+
+#include "bin_Serialization.h"
+#include "bin_File.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace ser {
+    /* encodes on the calling thread, writes on a dedicated I/O thread;
+       at most queue_depth encoded buffers wait for the disk at a time */
+    class AsyncWriter
+    {
+      private:
+        struct Job {
+            string path;
+            std::unique_ptr<binSerialization::BinaryWriter> buf;
+            std::promise<void> done;
+        };
+        size_t depth;
+        std::mutex lock;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+        std::condition_variable drained;
+        std::deque<Job> queue;
+        std::vector<std::unique_ptr<binSerialization::BinaryWriter>> spare;
+        size_t writing;
+        bool closed;
+        std::thread io;
+
+        void Run() {
+            std::unique_lock<std::mutex> guard(lock);
+            for(;;) {
+                not_empty.wait(guard, [this] { return closed || !queue.empty(); });
+                if(queue.empty())
+                    return;
+                Job job = std::move(queue.front());
+                queue.pop_front();
+                writing++;
+                not_full.notify_one();
+                guard.unlock();
+                try {
+                    binSerialization::FileSink file(job.path);
+                    file.Consume(job.buf->data(), job.buf->size());
+                    job.done.set_value();
+                } catch(...) {
+                    job.done.set_exception(std::current_exception());
+                }
+                job.buf->clear();
+                guard.lock();
+                if(spare.size() <= depth)
+                    spare.push_back(std::move(job.buf));
+                writing--;
+                if(queue.empty() && !writing)
+                    drained.notify_all();
+            }
+        }
+        std::unique_ptr<binSerialization::BinaryWriter> Acquire(binSerialization::Mode mode) {
+            std::unique_ptr<binSerialization::BinaryWriter> buf;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(closed)
+                    throw std::logic_error("ser::AsyncWriter: submit after Close()");
+                if(!spare.empty()) {
+                    buf = std::move(spare.back());
+                    spare.pop_back();
+                }
+            }
+            if(!buf)
+                buf.reset(new binSerialization::BinaryWriter);
+            buf->set_mode(mode);
+            return buf;
+        }
+        std::future<void> Enqueue(const string &path, std::unique_ptr<binSerialization::BinaryWriter> buf) {
+            Job job;
+            job.path = path;
+            job.buf = std::move(buf);
+            std::future<void> result = job.done.get_future();
+            std::unique_lock<std::mutex> guard(lock);
+            /* backpressure: the caller waits while the queue is full */
+            not_full.wait(guard, [this] { return closed || queue.size() < depth; });
+            if(closed)
+                throw std::logic_error("ser::AsyncWriter: submit after Close()");
+            queue.push_back(std::move(job));
+            not_empty.notify_one();
+            return result;
+        }
+      public:
+        explicit AsyncWriter(size_t queue_depth = 2)
+            : depth(queue_depth ? queue_depth : 1), writing(0), closed(false) {
+            io = std::thread(&AsyncWriter::Run, this);
+        }
+        AsyncWriter(const AsyncWriter&) = delete;
+        AsyncWriter& operator=(const AsyncWriter&) = delete;
+        ~AsyncWriter() {
+            Close();
+        }
+
+        /* binary normal type, appended to path once the I/O thread gets to it */
+        template <typename T>
+        std::future<void> Submit(const T &obj, const string &path, binSerialization::Mode mode = binSerialization::Mode::Default) {
+            std::unique_ptr<binSerialization::BinaryWriter> buf = Acquire(mode);
+            binSerialization::SerializeFrom(obj, *buf);
+            return Enqueue(path, std::move(buf));
+        }
+        /* For pointers */
+        template <typename T>
+        std::future<void> Submit(const T &obj, const string &path, size_t size, binSerialization::Mode mode = binSerialization::Mode::Default) {
+            std::unique_ptr<binSerialization::BinaryWriter> buf = Acquire(mode);
+            binSerialization::SerializeFrom(obj, *buf, size);
+            return Enqueue(path, std::move(buf));
+        }
+        /* blocks until everything submitted so far is on disk */
+        void Flush() {
+            std::unique_lock<std::mutex> guard(lock);
+            drained.wait(guard, [this] { return queue.empty() && !writing; });
+        }
+        /* flushes, then stops the I/O thread; further Submit calls throw */
+        void Close() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(closed)
+                    return;
+                closed = true;
+            }
+            not_empty.notify_all();
+            io.join();
+        }
+    };
+}  // namespace ser
+
+#endif
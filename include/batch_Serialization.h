@@ -0,0 +1,111 @@
+#ifndef __batch_Serialization_HEADER__
+#define __batch_Serialization_HEADER__
+
+#include "parallel_Serialization.h"
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace ser {
+    enum class Format {
+        Binary,
+        Xml
+    };
+    /* outcome of one batch job */
+    struct JobStatus {
+        bool ok;
+        string error;
+    };
+
+    /* serializes many independent objects to their own files on a
+       work-stealing pool; each worker reuses one BinaryWriter and one
+       XMLDocument for all of its jobs */
+    class BatchSerializer
+    {
+      private:
+        struct Context {
+            binSerialization::BinaryWriter buf;
+            XMLDocument doc;
+        };
+        struct Queue {
+            std::mutex lock;
+            std::deque<size_t> jobs;
+        };
+        std::vector<std::function<void(Context&)>> tasks;
+        unsigned threads;
+
+        /* own queue from the back, other queues from the front */
+        static bool Next(std::vector<std::unique_ptr<Queue>> &queues, unsigned self, size_t &job) {
+            {
+                std::lock_guard<std::mutex> guard(queues[self]->lock);
+                if(!queues[self]->jobs.empty()) {
+                    job = queues[self]->jobs.back();
+                    queues[self]->jobs.pop_back();
+                    return true;
+                }
+            }
+            for(size_t step = 1; step < queues.size(); step++) {
+                Queue &victim = *queues[(self + step) % queues.size()];
+                std::lock_guard<std::mutex> guard(victim.lock);
+                if(!victim.jobs.empty()) {
+                    job = victim.jobs.front();
+                    victim.jobs.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+      public:
+        explicit BatchSerializer(unsigned thread_count = 0)
+            : threads(thread_count ? thread_count : binSerialization::DefaultThreads()) {}
+
+        /* obj must stay alive until Run() returns; type_name is the XML node name */
+        template <typename T>
+        void Add(const T &obj, const string &path, Format format = Format::Binary, const string &type_name = "") {
+            const T *item = &obj;
+            if(format == Format::Binary) {
+                tasks.push_back([item, path](Context &ctx) {
+                    ctx.buf.clear();
+                    binSerialization::SerializeFrom(*item, ctx.buf);
+                    binSerialization::FileSink(path).Consume(ctx.buf.data(), ctx.buf.size());
+                });
+            } else {
+                tasks.push_back([item, path, type_name](Context &ctx) {
+                    {
+                        xmlSerialization::xmlSerialization ser_xml(path.c_str(), ctx.doc);
+                        ser_xml.SerializeFrom(*item, type_name, ser_xml.GetXmlRoot());
+                    }
+                    if(ctx.doc.Error())
+                        throw std::runtime_error(ctx.doc.ErrorStr());
+                });
+            }
+        }
+        /* runs every added job; statuses are in Add order */
+        std::vector<JobStatus> Run() {
+            std::vector<JobStatus> status(tasks.size(), JobStatus{true, string()});
+            unsigned workers = std::max(1u, std::min<unsigned>(threads, tasks.size()));
+            std::vector<std::unique_ptr<Queue>> queues;
+            for(unsigned k = 0; k < workers; k++)
+                queues.emplace_back(new Queue);
+            /* round-robin seeding; stealing evens out jobs of very different sizes */
+            for(size_t i = 0; i < tasks.size(); i++)
+                queues[i % workers]->jobs.push_back(i);
+            binSerialization::ParallelFor(workers, [&](unsigned self) {
+                Context ctx;
+                size_t job;
+                while(Next(queues, self, job)) {
+                    try {
+                        tasks[job](ctx);
+                    } catch(const std::exception &e) {
+                        status[job].ok = false;
+                        status[job].error = e.what();
+                    }
+                }
+            });
+            tasks.clear();
+            return status;
+        }
+    };
+}  // namespace ser
+
+#endif
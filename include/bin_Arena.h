@@ -0,0 +1,165 @@
+#ifndef __bin_Arena_HEADER__
+#define __bin_Arena_HEADER__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <memory>
+#include <new>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace binSerialization {
+    /* bump allocator over a chain of growing blocks. Nothing is freed one by
+       one; release() or the destructor returns every block at once */
+    class MonotonicArena
+    {
+      private:
+        struct Block {
+            Block *next;
+        };
+        Block *head;
+        char *cur;
+        size_t left;
+        size_t next_size;
+        size_t count;
+
+        void Grow(size_t bytes, size_t align) {
+            size_t want = std::max(next_size, bytes + align + sizeof(Block));
+            Block *block = static_cast<Block*>(std::malloc(want));
+            if(!block)
+                throw std::bad_alloc();
+            block->next = head;
+            head = block;
+            cur = reinterpret_cast<char*>(block + 1);
+            left = want - sizeof(Block);
+            next_size = want * 2;
+            count++;
+        }
+      public:
+        explicit MonotonicArena(size_t initial = 64 * 1024)
+            : head(nullptr), cur(nullptr), left(0), next_size(initial), count(0) {}
+        MonotonicArena(const MonotonicArena&) = delete;
+        MonotonicArena& operator=(const MonotonicArena&) = delete;
+        ~MonotonicArena() {
+            release();
+        }
+
+        void* allocate(size_t bytes, size_t align) {
+            size_t pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+            if(pad + bytes > left) {
+                Grow(bytes, align);
+                pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+            }
+            void *p = cur + pad;
+            cur += pad + bytes;
+            left -= pad + bytes;
+            return p;
+        }
+        /* every object built from the arena must be dead, or never destroyed */
+        void release() {
+            while(head) {
+                Block *next = head->next;
+                std::free(head);
+                head = next;
+            }
+            cur = nullptr;
+            left = 0;
+            count = 0;
+        }
+        size_t blocks() const {
+            return count;
+        }
+    };
+
+    /* allocator handing out arena memory. construct() passes the allocator
+       on to allocator-aware elements, so nested strings and containers of a
+       decoded tree come from the same arena. A default-constructed one falls
+       back to the heap. */
+    template <typename T>
+    class ArenaAllocator
+    {
+      private:
+        template <typename U> friend class ArenaAllocator;
+        MonotonicArena *arena;
+
+        template <typename U, typename... Args>
+        void Construct(U *p, std::true_type, Args&&... args) {
+            ::new(static_cast<void*>(p)) U(std::forward<Args>(args)..., *this);
+        }
+        template <typename U, typename... Args>
+        void Construct(U *p, std::false_type, Args&&... args) {
+            ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+        }
+      public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        ArenaAllocator() : arena(nullptr) {}
+        ArenaAllocator(MonotonicArena &owner) : arena(&owner) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+        T* allocate(size_t n) {
+            if(!arena)
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T *p, size_t) {
+            if(!arena)
+                ::operator delete(p);
+        }
+        template <typename U, typename... Args>
+        void construct(U *p, Args&&... args) {
+            Construct(p, std::integral_constant<bool, std::uses_allocator<U, ArenaAllocator>::value
+                          && std::is_constructible<U, Args..., const ArenaAllocator&>::value>(),
+                      std::forward<Args>(args)...);
+        }
+        MonotonicArena* resource() const {
+            return arena;
+        }
+        template <typename U>
+        bool operator==(const ArenaAllocator<U> &other) const {
+            return arena == other.arena;
+        }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const {
+            return arena != other.arena;
+        }
+    };
+
+    /* containers for decoding into an arena, e.g.
+           MonotonicArena arena;
+           ArenaMap<ArenaString, ArenaVector<int>> snapshot(arena);
+           des::deserialize(snapshot, path);
+       std::pmr containers work the same way when built as C++17 */
+    typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+    template <typename T>
+    using ArenaList = std::list<T, ArenaAllocator<T>>;
+    template <typename T>
+    using ArenaSet = std::set<T, std::less<T>, ArenaAllocator<T>>;
+    template <typename T1, typename T2>
+    using ArenaMap = std::map<T1, T2, std::less<T1>, ArenaAllocator<std::pair<const T1, T2>>>;
+}  // namespace binSerialization
+
+namespace binDeserialization {
+    using binSerialization::MonotonicArena;
+    using binSerialization::ArenaAllocator;
+    using binSerialization::ArenaString;
+    using binSerialization::ArenaVector;
+    using binSerialization::ArenaList;
+    using binSerialization::ArenaSet;
+    using binSerialization::ArenaMap;
+}  // namespace binDeserialization
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef __bin_Buffer_HEADER__
+#define __bin_Buffer_HEADER__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+namespace binSerialization {
+    /* archive options, selected per writer/reader or per ser/des call */
+    enum class Mode : unsigned {
+        Default = 0,
+        Compact = 1,     // LEB128 lengths and integers, zigzag for signed
+        TrackShared = 2, // shared_ptr pointees written once, repeats as back-references
+        ReuseInPlace = 4 // decoding overwrites existing elements and pointees (reader only)
+    };
+    inline constexpr Mode operator|(Mode a, Mode b) {
+        return static_cast<Mode>(static_cast<unsigned>(a) | static_cast<unsigned>(b));
+    }
+    inline constexpr bool HasMode(Mode set, Mode flag) {
+        return (static_cast<unsigned>(set) & static_cast<unsigned>(flag)) != 0;
+    }
+
+    /* types whose encoding is exactly their object representation */
+    template <typename T, typename Enable = void>
+    struct IsBulkType : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> {};
+    /* integers that Mode::Compact stores as varints; single bytes stay raw */
+    template <typename T>
+    struct VarintType : std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value && (sizeof(T) > 1)> {};
+    /* run-time veto on the block copy of a bulk type whose layout can only be
+       checked on an object, such as the member order of a SERIALIZE_FIELDS type */
+    template <typename T, typename Enable = void>
+    struct BulkLayout {
+        static bool ok() { return true; }
+    };
+    /* bulk types that contain a varint, and so lose the block copy in Mode::Compact */
+    template <typename T, typename Enable = void>
+    struct HasVarint : VarintType<T> {};
+
+    template <typename T>
+    inline constexpr uint64_t ZigZag(T val, std::true_type) {
+        int64_t v = val;
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+    template <typename T>
+    inline constexpr uint64_t ZigZag(T val, std::false_type) {
+        return val;
+    }
+    template <typename T>
+    inline constexpr uint64_t ToVarint(T val) {
+        return ZigZag(val, std::is_signed<T>());
+    }
+    template <typename T>
+    inline T UnZigZag(uint64_t v, std::true_type) {
+        return static_cast<T>(static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1));
+    }
+    template <typename T>
+    inline T UnZigZag(uint64_t v, std::false_type) {
+        return static_cast<T>(v);
+    }
+    template <typename T>
+    inline T FromVarint(uint64_t v) {
+        return UnZigZag<T>(v, std::is_signed<T>());
+    }
+    inline constexpr size_t VarintSize(uint64_t v) {
+        return v < (1ull << 7) ? 1 : 1 + VarintSize(v >> 7);
+    }
+
+    /* one fixed-width value from raw input; a bool must be 0 or 1, since any
+       other byte copied into it is not a valid bool */
+    template <typename T>
+    inline void LoadValue(T &val, const char *src) {
+        std::memcpy(&val, src, sizeof(T));
+    }
+    inline void LoadValue(bool &val, const char *src) {
+        static_assert(sizeof(bool) == 1, "bool is encoded as one byte");
+        unsigned char byte = static_cast<unsigned char>(*src);
+        if(byte > 1)
+            throw std::out_of_range("binDeserialization: malformed bool");
+        val = byte != 0;
+    }
+
+    /* default window for streaming writers and readers */
+    constexpr size_t kChunkSize = 1 << 20;
+
+    /* destination for a streaming BinaryWriter */
+    class ByteSink
+    {
+      public:
+        virtual ~ByteSink() {}
+        virtual void Consume(const char *data, size_t n) = 0;
+    };
+
+    /* contiguous, geometrically growing output buffer; with a sink it
+       instead keeps a fixed window and hands it over whenever it fills */
+    class BinaryWriter
+    {
+      private:
+        char *head;
+        char *cur;
+        char *tail;
+        Mode mode_;
+        ByteSink *sink;
+        size_t flushed;
+        std::map<std::pair<const void*, std::type_index>, unsigned int> shared_ids;
+
+        void Grow(size_t need) {
+            if(sink) {
+                flush();
+                if(static_cast<size_t>(tail - cur) >= need)
+                    return;
+            }
+            size_t used = cur - head;
+            size_t capacity = tail - head;
+            size_t new_capacity = capacity < 32 ? 64 : capacity * 2;
+            if(new_capacity < used + need)
+                new_capacity = used + need;
+            char *new_head = static_cast<char*>(std::realloc(head, new_capacity));
+            if(!new_head)
+                throw std::bad_alloc();
+            head = new_head;
+            cur = new_head + used;
+            tail = new_head + new_capacity;
+        }
+        template <typename T>
+        void PutNumber(const T &val, std::true_type) {
+            if(compact())
+                put_varint(ToVarint(val));
+            else
+                put(val);
+        }
+        template <typename T>
+        void PutNumber(const T &val, std::false_type) {
+            put(val);
+        }
+      public:
+        explicit BinaryWriter(size_t capacity = 0, Mode mode = Mode::Default)
+            : head(nullptr), cur(nullptr), tail(nullptr), mode_(mode), sink(nullptr), flushed(0) {
+            if(capacity)
+                Grow(capacity);
+        }
+        /* streaming: memory stays at capacity; call flush() when done */
+        explicit BinaryWriter(ByteSink &out, size_t capacity = kChunkSize, Mode mode = Mode::Default)
+            : head(nullptr), cur(nullptr), tail(nullptr), mode_(mode), sink(nullptr), flushed(0) {
+            Grow(capacity < 64 ? 64 : capacity);
+            sink = &out;
+        }
+        BinaryWriter(const BinaryWriter&) = delete;
+        BinaryWriter& operator=(const BinaryWriter&) = delete;
+        ~BinaryWriter() {
+            std::free(head);
+        }
+
+        /* fixed-width value, copied byte by byte */
+        template <typename T>
+        void put(const T &val) {
+            static_assert(std::is_trivially_copyable<T>::value, "put() needs a trivially copyable type");
+            if(static_cast<size_t>(tail - cur) < sizeof(T))
+                Grow(sizeof(T));
+            std::memcpy(cur, &val, sizeof(T));
+            cur += sizeof(T);
+        }
+        /* LEB128, 7 bits per byte, high bit set on all but the last */
+        void put_varint(uint64_t val) {
+            if(static_cast<size_t>(tail - cur) < 10)
+                Grow(10);
+            while(val >= 0x80) {
+                *cur++ = static_cast<char>(val | 0x80);
+                val >>= 7;
+            }
+            *cur++ = static_cast<char>(val);
+        }
+        /* arithmetic field, honouring Mode::Compact */
+        template <typename T>
+        void put_number(const T &val) {
+            PutNumber(val, VarintType<T>());
+        }
+        /* container or pointer length, honouring Mode::Compact */
+        template <typename L>
+        void put_length(L n) {
+            if(compact())
+                put_varint(n);
+            else
+                put(n);
+        }
+        /* raw bytes */
+        void write(const char *src, size_t n) {
+            if(sink && n > static_cast<size_t>(tail - head)) {
+                flush();
+                sink->Consume(src, n);
+                flushed += n;
+                return;
+            }
+            if(static_cast<size_t>(tail - cur) < n)
+                Grow(n);
+            if(n)
+                std::memcpy(cur, src, n);
+            cur += n;
+        }
+        /* n bytes at the end of the buffer for the caller to fill in place */
+        char* claim(size_t n) {
+            if(static_cast<size_t>(tail - cur) < n)
+                Grow(n);
+            char *dst = cur;
+            cur += n;
+            return dst;
+        }
+        /* n contiguous fixed-width values in one copy */
+        template <typename T>
+        void write_array(const T *src, size_t n) {
+            static_assert(std::is_trivially_copyable<T>::value, "write_array() needs a trivially copyable type");
+            write(reinterpret_cast<const char*>(src), n * sizeof(T));
+        }
+        /* whether an array of T may be block-copied under the current mode */
+        template <typename T>
+        bool raw() const {
+            return IsBulkType<T>::value && BulkLayout<T>::ok() && !(compact() && HasVarint<T>::value);
+        }
+        void reserve(size_t n) {
+            if(static_cast<size_t>(tail - cur) < n)
+                Grow(n);
+        }
+        /* bytes that fit before the buffer grows or the window is flushed */
+        size_t available() const {
+            return tail - cur;
+        }
+        bool streaming() const {
+            return sink != nullptr;
+        }
+        /* hands buffered bytes to the sink, if any */
+        void flush() {
+            if(sink && cur != head) {
+                sink->Consume(head, cur - head);
+                flushed += cur - head;
+                cur = head;
+            }
+        }
+        /* starts a new archive: also forgets the objects seen by Mode::TrackShared */
+        void clear() {
+            cur = head;
+            shared_ids.clear();
+        }
+        /* buffered bytes, i.e. everything written unless streaming */
+        const char* data() const {
+            return head;
+        }
+        /* writable, to fill in a header claimed ahead of its payload */
+        char* data() {
+            return head;
+        }
+        size_t size() const {
+            return cur - head;
+        }
+        /* total bytes written, including those already flushed */
+        size_t position() const {
+            return flushed + size();
+        }
+        std::string str() const {
+            return std::string(head, size());
+        }
+        Mode mode() const {
+            return mode_;
+        }
+        void set_mode(Mode mode) {
+            mode_ = mode;
+        }
+        bool compact() const {
+            return HasMode(mode_, Mode::Compact);
+        }
+        bool tracks_shared() const {
+            return HasMode(mode_, Mode::TrackShared);
+        }
+        /* Mode::TrackShared: true with the id of an object written before,
+           otherwise false with the id just assigned to it */
+        template <typename T>
+        bool shared_seen(const T *obj, unsigned int &id) {
+            auto found = shared_ids.emplace(std::make_pair(static_cast<const void*>(obj), std::type_index(typeid(T))),
+                                            static_cast<unsigned int>(shared_ids.size()));
+            id = found.first->second;
+            return !found.second;
+        }
+    };
+}  // namespace binSerialization
+
+namespace binDeserialization {
+    using binSerialization::Mode;
+    using binSerialization::HasMode;
+    using binSerialization::IsBulkType;
+    using binSerialization::BulkLayout;
+    using binSerialization::VarintType;
+    using binSerialization::HasVarint;
+
+    /* origin for a streaming BinaryReader; Produce returns 0 at end of input */
+    class ByteSource
+    {
+      public:
+        virtual ~ByteSource() {}
+        virtual size_t Produce(char *dst, size_t n) = 0;
+        /* bytes still to come, SIZE_MAX when unknown */
+        virtual size_t Remaining() const {
+            return SIZE_MAX;
+        }
+    };
+
+    /* bounds-checked cursor over a caller-owned byte span; with a source it
+       instead walks a fixed window that is refilled as it is consumed */
+    class BinaryReader
+    {
+      private:
+        const char *head;
+        const char *cur;
+        const char *tail;
+        Mode mode_;
+        ByteSource *source;
+        std::unique_ptr<char[]> window;
+        size_t window_size;
+        size_t base_size;            // window_size as configured
+        size_t consumed;
+        std::vector<std::pair<std::shared_ptr<void>, std::type_index>> shared_objs;
+
+        /* slides the unread bytes to the front and tops the window up */
+        void Fill(size_t n) {
+            size_t avail = tail - cur;
+            if(n > window_size || (window_size > base_size && n <= base_size && avail <= base_size)) {
+                /* grows for an oversized field, and shrinks back once it is consumed */
+                size_t size = std::max(n, base_size);
+                std::unique_ptr<char[]> resized(new char[size]);
+                std::memcpy(resized.get(), cur, avail);
+                window = std::move(resized);
+                window_size = size;
+            } else if(avail) {
+                std::memmove(window.get(), cur, avail);
+            }
+            consumed += cur - head;
+            head = cur = window.get();
+            char *end = window.get() + avail;
+            while(static_cast<size_t>(end - cur) < n) {
+                size_t got = source->Produce(end, window.get() + window_size - end);
+                if(!got)
+                    break;
+                end += got;
+            }
+            tail = end;
+        }
+        void Require(size_t n) {
+            if(static_cast<size_t>(tail - cur) < n) {
+                if(source)
+                    Fill(n);
+                if(static_cast<size_t>(tail - cur) < n)
+                    throw std::out_of_range("binDeserialization: read past end of buffer");
+            }
+        }
+        template <typename T>
+        void GetNumber(T &val, std::true_type) {
+            if(compact())
+                val = binSerialization::FromVarint<T>(get_varint(std::numeric_limits<typename std::make_unsigned<T>::type>::max()));
+            else
+                get(val);
+        }
+        template <typename T>
+        void GetNumber(T &val, std::false_type) {
+            get(val);
+        }
+      public:
+        BinaryReader(const char *data, size_t len, Mode mode = Mode::Default)
+            : head(data), cur(data), tail(data + len), mode_(mode),
+              source(nullptr), window_size(0), base_size(0), consumed(0) {}
+        /* streaming: memory stays at capacity apart from single oversized fields */
+        explicit BinaryReader(ByteSource &in, size_t capacity = binSerialization::kChunkSize, Mode mode = Mode::Default)
+            : head(nullptr), cur(nullptr), tail(nullptr), mode_(mode), source(&in),
+              window(new char[capacity < 64 ? 64 : capacity]), window_size(capacity < 64 ? 64 : capacity),
+              base_size(window_size), consumed(0) {
+            head = cur = tail = window.get();
+        }
+
+        /* fixed-width value, copied byte by byte */
+        template <typename T>
+        void get(T &val) {
+            static_assert(std::is_trivially_copyable<T>::value, "get() needs a trivially copyable type");
+            Require(sizeof(T));
+            binSerialization::LoadValue(val, cur);
+            cur += sizeof(T);
+        }
+        /* LEB128; away from the end of the buffer no per-byte checks are needed */
+        uint64_t get_varint() {
+            if(source && tail - cur < 10)
+                Fill(10);
+            const unsigned char *p = reinterpret_cast<const unsigned char*>(cur);
+            size_t avail = tail - cur;
+            size_t limit = avail < 10 ? avail : 10;
+            uint64_t val = 0;
+            for(size_t i = 0; i < limit; i++) {
+                unsigned char byte = p[i];
+                /* the tenth byte holds only bit 63 */
+                if(i == 9 && byte > 1)
+                    throw std::out_of_range("binDeserialization: malformed varint");
+                val |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+                if(!(byte & 0x80)) {
+                    cur += i + 1;
+                    return val;
+                }
+            }
+            if(limit < 10)
+                throw std::out_of_range("binDeserialization: read past end of buffer");
+            throw std::out_of_range("binDeserialization: malformed varint");
+        }
+        /* varint that must fit in a narrower field */
+        uint64_t get_varint(uint64_t max) {
+            uint64_t val = get_varint();
+            if(val > max)
+                throw std::out_of_range("binDeserialization: varint out of range");
+            return val;
+        }
+        /* arithmetic field, honouring Mode::Compact */
+        template <typename T>
+        void get_number(T &val) {
+            GetNumber(val, VarintType<T>());
+        }
+        /* container or pointer length, honouring Mode::Compact */
+        template <typename L>
+        void get_length(L &n) {
+            if(compact())
+                n = static_cast<L>(get_varint(std::numeric_limits<L>::max()));
+            else
+                get(n);
+        }
+        /* raw bytes */
+        void read(char *dst, size_t n) {
+            if(source && n > window_size) {
+                /* too large for the window: drain it, then read straight into dst */
+                size_t avail = tail - cur;
+                std::memcpy(dst, cur, avail);
+                cur = tail;
+                for(size_t done = avail; done < n; ) {
+                    size_t got = source->Produce(dst + done, n - done);
+                    if(!got)
+                        throw std::out_of_range("binDeserialization: read past end of buffer");
+                    done += got;
+                    consumed += got;
+                }
+                return;
+            }
+            Require(n);
+            if(n)
+                std::memcpy(dst, cur, n);
+            cur += n;
+        }
+        /* next n bytes in place, consumed; valid until the next read */
+        const char* take(size_t n) {
+            Require(n);
+            const char *src = cur;
+            cur += n;
+            return src;
+        }
+        /* n contiguous fixed-width values in one copy */
+        template <typename T>
+        void read_array(T *dst, size_t n) {
+            static_assert(std::is_trivially_copyable<T>::value, "read_array() needs a trivially copyable type");
+            require_items(n, sizeof(T));
+            read(reinterpret_cast<char*>(dst), n * sizeof(T));
+        }
+        /* whether an array of T may be block-copied under the current mode */
+        template <typename T>
+        bool raw() const {
+            return IsBulkType<T>::value && BulkLayout<T>::ok() && !(compact() && HasVarint<T>::value);
+        }
+        /* fails before the caller allocates for a count the input cannot hold;
+           a streaming reader counts what its source can still supply, if known */
+        void require_items(size_t count, size_t width) const {
+            size_t left = remaining();
+            if(source) {
+                size_t more = source->Remaining();
+                if(more == SIZE_MAX)
+                    return;
+                left += more;
+            }
+            if(width && count > left / width)
+                throw std::out_of_range("binDeserialization: read past end of buffer");
+        }
+        /* next n bytes in place, without consuming them; a streaming reader
+           has to grow its window to n for this */
+        const char* peek(size_t n) {
+            Require(n);
+            return cur;
+        }
+        bool streaming() const {
+            return source != nullptr;
+        }
+        void skip(size_t n) {
+            while(source && n > static_cast<size_t>(tail - cur)) {
+                n -= tail - cur;
+                cur = tail;
+                Require(n < window_size ? n : window_size);
+            }
+            Require(n);
+            cur += n;
+        }
+        size_t position() const {
+            return consumed + (cur - head);
+        }
+        /* bytes available without refilling */
+        size_t remaining() const {
+            return tail - cur;
+        }
+        Mode mode() const {
+            return mode_;
+        }
+        void set_mode(Mode mode) {
+            mode_ = mode;
+        }
+        bool compact() const {
+            return HasMode(mode_, Mode::Compact);
+        }
+        bool tracks_shared() const {
+            return HasMode(mode_, Mode::TrackShared);
+        }
+        bool reuses() const {
+            return HasMode(mode_, Mode::ReuseInPlace);
+        }
+        /* Mode::TrackShared: registers a new object under the next id */
+        template <typename T>
+        void share(const std::shared_ptr<T> &obj) {
+            shared_objs.emplace_back(obj, std::type_index(typeid(T)));
+        }
+        /* object registered under id, checked against the expected type */
+        template <typename T>
+        std::shared_ptr<T> shared_at(unsigned int id) const {
+            if(id >= shared_objs.size() || shared_objs[id].second != std::type_index(typeid(T)))
+                throw std::out_of_range("binDeserialization: malformed shared reference");
+            return std::static_pointer_cast<T>(shared_objs[id].first);
+        }
+    };
+}  // namespace binDeserialization
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef __bin_Columnar_HEADER__
+#define __bin_Columnar_HEADER__
+
+#include "serialize.h"
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace binSerialization {
+    /* one column per field: numbers back to back, strings as all lengths then
+       all characters, vectors of numbers as all lengths then all elements,
+       anything else element by element */
+    template <typename T, typename F>
+    typename std::enable_if<std::is_arithmetic<F>::value>::type
+    SerializeColumn(const std::vector<T> &obj, F T::*member, BinaryWriter &buf) {
+        if(!buf.raw<F>()) {
+            for(auto& row : obj)
+                buf.put_number(row.*member);
+            return;
+        }
+        /* gathered into one claimed block per window */
+        const size_t step = std::max<size_t>(1, kChunkSize / sizeof(F));
+        for(size_t i = 0; i < obj.size(); i += step) {
+            size_t n = std::min(step, obj.size() - i);
+            char *dst = buf.claim(n * sizeof(F));
+            for(size_t j = 0; j < n; j++)
+                std::memcpy(dst + j * sizeof(F), &(obj[i + j].*member), sizeof(F));
+        }
+    }
+    template <typename T>
+    void SerializeColumn(const std::vector<T> &obj, std::string T::*member, BinaryWriter &buf) {
+        for(auto& row : obj) {
+            unsigned int size = (row.*member).size();
+            buf.put_length(size);
+        }
+        for(auto& row : obj)
+            buf.write((row.*member).data(), (row.*member).size());
+    }
+    template <typename T, typename E>
+    void SerializeColumn(const std::vector<T> &obj, std::vector<E> T::*member, BinaryWriter &buf) {
+        for(auto& row : obj) {
+            unsigned int size = (row.*member).size();
+            buf.put_length(size);
+        }
+        for(auto& row : obj)
+            SerializeArray((row.*member).data(), (row.*member).size(), buf, IsBulkType<E>());
+    }
+    template <typename T, typename F>
+    typename std::enable_if<!std::is_arithmetic<F>::value>::type
+    SerializeColumn(const std::vector<T> &obj, F T::*member, BinaryWriter &buf) {
+        for(auto& row : obj)
+            SerializeFrom(row.*member, buf);
+    }
+
+    template <typename T, typename Tuple, size_t... I>
+    void SerializeColumns(const std::vector<T> &obj, const Tuple &members, BinaryWriter &buf, std::index_sequence<I...>) {
+        int arr[] = {0, (SerializeColumn(obj, std::get<I>(members), buf), 0)...};
+        (void)arr;
+    }
+    /* vector of a SERIALIZE_FIELDS type, field by field (struct of arrays) */
+    template <typename T>
+    void SerializeColumns(const std::vector<T> &obj, BinaryWriter &buf) {
+        auto members = Fields<T>::members();
+        unsigned int size = obj.size();
+        buf.put_length(size);
+        SerializeColumns(obj, members, buf, std::make_index_sequence<std::tuple_size<decltype(members)>::value>());
+    }
+}  // namespace binSerialization
+
+namespace binDeserialization {
+    using binSerialization::Fields;
+
+    template <typename T, typename F>
+    typename std::enable_if<std::is_arithmetic<F>::value>::type
+    DeserializeColumn(std::vector<T> &obj, F T::*member, BinaryReader &buf) {
+        if(!buf.raw<F>()) {
+            for(auto& row : obj)
+                buf.get_number(row.*member);
+            return;
+        }
+        /* one bounds check per window, then scattered into the rows */
+        buf.require_items(obj.size(), sizeof(F));
+        const size_t step = std::max<size_t>(1, binSerialization::kChunkSize / sizeof(F));
+        for(size_t i = 0; i < obj.size(); i += step) {
+            size_t n = std::min(step, obj.size() - i);
+            const char *src = buf.take(n * sizeof(F));
+            for(size_t j = 0; j < n; j++)
+                std::memcpy(&(obj[i + j].*member), src + j * sizeof(F), sizeof(F));
+        }
+    }
+    /* lengths first, so every row is sized before the characters are copied */
+    template <typename T>
+    void DeserializeColumn(std::vector<T> &obj, std::string T::*member, BinaryReader &buf) {
+        /* the characters of all rows so far must still be in the buffer */
+        size_t total = 0;
+        for(auto& row : obj) {
+            unsigned int size;
+            buf.get_length(size);
+            total += size;
+            buf.require_items(total, 1);
+            (row.*member).resize(size);
+        }
+        for(auto& row : obj)
+            if(!(row.*member).empty())
+                buf.read(&(row.*member)[0], (row.*member).size());
+    }
+    template <typename T, typename E>
+    void DeserializeColumn(std::vector<T> &obj, std::vector<E> T::*member, BinaryReader &buf) {
+        std::vector<unsigned int> sizes(obj.size());
+        size_t total = 0;
+        for(auto& size : sizes) {
+            buf.get_length(size);
+            total += size;
+            buf.require_items(total, 1);
+        }
+        for(size_t i = 0; i < obj.size(); i++) {
+            (obj[i].*member).clear();
+            DeserializeVector(obj[i].*member, sizes[i], buf, IsBulkType<E>());
+        }
+    }
+    template <typename T, typename F>
+    typename std::enable_if<!std::is_arithmetic<F>::value>::type
+    DeserializeColumn(std::vector<T> &obj, F T::*member, BinaryReader &buf) {
+        for(auto& row : obj)
+            DeserializeTo(row.*member, buf);
+    }
+
+    template <typename T, typename Tuple, size_t... I>
+    void DeserializeColumns(std::vector<T> &obj, const Tuple &members, BinaryReader &buf, std::index_sequence<I...>) {
+        int arr[] = {0, (DeserializeColumn(obj, std::get<I>(members), buf), 0)...};
+        (void)arr;
+    }
+    /* vector of a user defined type written by SerializeColumns */
+    template <typename T>
+    void DeserializeColumns(std::vector<T> &obj, BinaryReader &buf) {
+        auto members = Fields<T>::members();
+        unsigned int size;
+        buf.get_length(size);
+        buf.require_items(size, 1);
+        obj.clear();
+        obj.resize(size);
+        DeserializeColumns(obj, members, buf, std::make_index_sequence<std::tuple_size<decltype(members)>::value>());
+    }
+}  // namespace binDeserialization
+
+namespace ser {
+    /* vector of a user defined type in columnar layout */
+    template <typename T>
+    void serialize_columns(const std::vector<T> &obj, const string &path, binSerialization::Mode mode = binSerialization::Mode::Default) {
+        binSerialization::FileSink file(path);
+        binSerialization::BinaryWriter buf(file, binSerialization::kChunkSize, mode);
+        binSerialization::SerializeColumns(obj, buf);
+        buf.flush();
+    }
+}  // namespace ser
+
+namespace des {
+    template <typename T>
+    void deserialize_columns(std::vector<T> &obj, const string &path, binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        binDeserialization::MappedFile file(path);
+        binDeserialization::BinaryReader buf(file.data(), file.size(), mode);
+        binDeserialization::DeserializeColumns(obj, buf);
+    }
+}  // namespace des
+
+#endif
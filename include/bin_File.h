@@ -0,0 +1,216 @@
+#ifndef __bin_File_HEADER__
+#define __bin_File_HEADER__
+
+#include "bin_Buffer.h"
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace binSerialization {
+    /* appends to a file through its descriptor */
+    class FileSink : public ByteSink
+    {
+      private:
+        int fd;
+      public:
+        explicit FileSink(const std::string &path) {
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if(fd < 0)
+                throw std::runtime_error("binSerialization: cannot open " + path);
+        }
+        FileSink(const FileSink&) = delete;
+        FileSink& operator=(const FileSink&) = delete;
+        ~FileSink() {
+            ::close(fd);
+        }
+        void Consume(const char *data, size_t n) override {
+            while(n) {
+                ssize_t done = ::write(fd, data, n);
+                if(done < 0 && errno == EINTR)
+                    continue;
+                if(done < 0)
+                    throw std::runtime_error("binSerialization: write failed");
+                data += done;
+                n -= done;
+            }
+        }
+    };
+    /* FileSink opened only when the first bytes arrive, so an encoding that
+       fails within the first window leaves the file as it was */
+    class DeferredFileSink : public ByteSink
+    {
+      private:
+        std::string path;
+        std::unique_ptr<FileSink> file;
+      public:
+        explicit DeferredFileSink(const std::string &target) : path(target) {}
+        void Consume(const char *data, size_t n) override {
+            Open();
+            file->Consume(data, n);
+        }
+        /* creates the file even if nothing was written */
+        void Open() {
+            if(!file)
+                file.reset(new FileSink(path));
+        }
+    };
+    /* writes at an explicit offset of a caller-owned descriptor, so several
+       sinks can fill disjoint ranges of one file concurrently */
+    class OffsetSink : public ByteSink
+    {
+      private:
+        int fd;
+        off_t offset;
+      public:
+        OffsetSink(int file, off_t start) : fd(file), offset(start) {}
+        void Consume(const char *data, size_t n) override {
+            while(n) {
+                ssize_t done = ::pwrite(fd, data, n, offset);
+                if(done < 0 && errno == EINTR)
+                    continue;
+                if(done < 0)
+                    throw std::runtime_error("binSerialization: write failed");
+                data += done;
+                offset += done;
+                n -= done;
+            }
+        }
+    };
+}  // namespace binSerialization
+
+namespace binDeserialization {
+    /* sequential reads from a file descriptor */
+    class FileSource : public ByteSource
+    {
+      private:
+        int fd;
+        size_t left;                 // SIZE_MAX unless a regular file
+      public:
+        explicit FileSource(const std::string &path) : left(SIZE_MAX) {
+            fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error("binDeserialization: cannot open " + path);
+            struct stat st;
+            if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+                left = st.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        }
+        FileSource(const FileSource&) = delete;
+        FileSource& operator=(const FileSource&) = delete;
+        ~FileSource() {
+            ::close(fd);
+        }
+        size_t Produce(char *dst, size_t n) override {
+            for(;;) {
+                ssize_t got = ::read(fd, dst, n);
+                if(got < 0 && errno == EINTR)
+                    continue;
+                if(got < 0)
+                    throw std::runtime_error("binDeserialization: read failed");
+                if(left != SIZE_MAX)
+                    left -= std::min<size_t>(left, got);
+                return got;
+            }
+        }
+        size_t Remaining() const override {
+            return left;
+        }
+    };
+
+    /* read-only view of a whole file: mmap for regular files, read() otherwise */
+    class MappedFile
+    {
+      private:
+        const char *addr;
+        size_t len;
+        bool mapped;
+        std::string copy;
+
+        void ReadAll(int fd) {
+            char chunk[1 << 16];
+            for(;;) {
+                ssize_t n = ::read(fd, chunk, sizeof(chunk));
+                if(n < 0 && errno == EINTR)
+                    continue;
+                if(n < 0)
+                    throw std::runtime_error("binDeserialization: read failed");
+                if(n == 0)
+                    break;
+                copy.append(chunk, n);
+            }
+            addr = copy.data();
+            len = copy.size();
+        }
+      public:
+        explicit MappedFile(const std::string &path) : addr(nullptr), len(0), mapped(false) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw std::runtime_error("binDeserialization: cannot open " + path);
+            struct stat st;
+            if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p != MAP_FAILED) {
+                    ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+                    addr = static_cast<const char*>(p);
+                    len = st.st_size;
+                    mapped = true;
+                }
+            }
+            if(!mapped) {
+                try {
+                    ReadAll(fd);
+                } catch(...) {
+                    ::close(fd);
+                    throw;
+                }
+            }
+            ::close(fd);
+        }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() {
+            if(mapped)
+                ::munmap(const_cast<char*>(addr), len);
+        }
+        const char* data() const {
+            return addr;
+        }
+        size_t size() const {
+            return len;
+        }
+    };
+
+    /* a decoded value together with the mapped file its views point into */
+    template <typename T>
+    class MappedView
+    {
+      private:
+        std::unique_ptr<MappedFile> file;
+        T value;
+      public:
+        explicit MappedView(const std::string &path, Mode mode = Mode::Default) : file(new MappedFile(path)) {
+            BinaryReader buf(file->data(), file->size(), mode);
+            DeserializeTo(value, buf);
+        }
+        const T& get() const {
+            return value;
+        }
+        const T& operator*() const {
+            return value;
+        }
+        const T* operator->() const {
+            return &value;
+        }
+    };
+}  // namespace binDeserialization
+
+#endif
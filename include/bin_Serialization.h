@@ -2,6 +2,8 @@
 #define __bin_Serialization_HEADER__
 
 #include "macro.h"
+#include "bin_Buffer.h"
+#include "bin_StringView.h"
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -13,183 +15,956 @@
 #include <set>
 #include <map>
 #include <utility>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <initializer_list>
+#include <tuple>
 
 using namespace std;
 
 namespace binSerialization {
+    /* SERIALIZE_FIELDS types: facts about the member list */
+    template <typename M>
+    struct MemberOf;
+    template <typename C, typename F>
+    struct MemberOf<F C::*> {
+        typedef F type;
+    };
+    inline constexpr bool AllOf(std::initializer_list<bool> list) {
+        for(bool item : list)
+            if(!item)
+                return false;
+        return true;
+    }
+    inline constexpr bool AnyOf(std::initializer_list<bool> list) {
+        for(bool item : list)
+            if(item)
+                return true;
+        return false;
+    }
+    inline constexpr size_t SumOf(std::initializer_list<size_t> list) {
+        size_t sum = 0;
+        for(size_t item : list)
+            sum += item;
+        return sum;
+    }
+    template <typename Tuple>
+    struct FieldList;
+    template <typename... M>
+    struct FieldList<std::tuple<M...>> {
+        static constexpr bool bulk = AllOf({IsBulkType<typename MemberOf<M>::type>::value...});
+        static constexpr size_t bytes = SumOf({sizeof(typename MemberOf<M>::type)...});
+        static constexpr bool varint = AnyOf({HasVarint<typename MemberOf<M>::type>::value...});
+    };
+    template <typename T>
+    using FieldsOf = FieldList<decltype(Fields<T>::members())>;
+    /* all-bulk fields without padding: the struct itself is block copied */
+    template <typename T>
+    struct IsBulkType<T, FIELDS_TYPE>
+        : std::integral_constant<bool, FieldsOf<T>::bulk && std::is_trivially_copyable<T>::value
+                                       && sizeof(T) == FieldsOf<T>::bytes> {};
+    /* ... and only if the member list is the memory order: each field starts
+       where the one before it ends, so a block copy equals the field-wise encoding */
+    template <typename T>
+    struct BulkLayout<T, FIELDS_TYPE> {
+        template <typename Tuple, size_t... I>
+        static bool InOrder(const T &probe, const Tuple &members, std::index_sequence<I...>) {
+            const char *base = reinterpret_cast<const char*>(&probe);
+            size_t expect = 0;
+            bool in_order = true;
+            int arr[] = {0, (in_order = in_order && reinterpret_cast<const char*>(&(probe.*std::get<I>(members))) - base == static_cast<std::ptrdiff_t>(expect),
+                             expect += sizeof(probe.*std::get<I>(members)), 0)...};
+            (void)arr;
+            return in_order;
+        }
+        static bool Check() {
+            T probe = T();
+            return InOrder(probe, Fields<T>::members(), std::make_index_sequence<std::tuple_size<decltype(Fields<T>::members())>::value>());
+        }
+        static bool ok() {
+            static const bool in_order = !IsBulkType<T>::value || Check();
+            return in_order;
+        }
+    };
+    template <typename T>
+    struct HasVarint<T, FIELDS_TYPE> : std::integral_constant<bool, FieldsOf<T>::varint> {};
+    /* array of bulk elements, laid out without gaps */
+    template <typename T, size_t N>
+    struct IsBulkType<std::array<T, N>> : std::integral_constant<bool, IsBulkType<T>::value && sizeof(std::array<T, N>) == N * sizeof(T)> {};
+    template <typename T, size_t N>
+    struct HasVarint<std::array<T, N>> : HasVarint<T> {};
+
+    /* fixed-width records: Store/Load copy one record at a raw address */
+    template <typename T, typename Enable = void>
+    struct FixedSize;
+    template <typename T>
+    char* StoreFixed(const T &obj, char *dst) {
+        return FixedSize<T>::Store(obj, dst);
+    }
+    template <typename T>
+    const char* LoadFixed(T &obj, const char *src) {
+        return FixedSize<T>::Load(obj, src);
+    }
+    /* one record in a single claim, unless Mode::Compact turns a field into a varint */
+    template <typename T>
+    bool PutRecord(const T &obj, BinaryWriter &buf, std::true_type) {
+        if(buf.compact() && FixedSize<T>::varint)
+            return false;
+        StoreFixed(obj, buf.claim(FixedSize<T>::bytes));
+        return true;
+    }
+    template <typename T>
+    bool PutRecord(const T&, BinaryWriter&, std::false_type) {
+        return false;
+    }
+    /* records at a precomputed stride: space is claimed per batch, not per field */
+    template <typename T>
+    void SerializeRecords(const T *obj, size_t size, BinaryWriter &buf, std::false_type) {
+        for(size_t i = 0; i < size; i++)
+            SerializeFrom(obj[i], buf);
+    }
+    template <typename T>
+    void SerializeRecords(const T *obj, size_t size, BinaryWriter &buf, std::true_type) {
+        typedef FixedSize<T> Fixed;
+        if((buf.compact() && Fixed::varint) || !Fixed::bytes)
+            return SerializeRecords(obj, size, buf, std::false_type());
+        if(!buf.streaming())
+            buf.reserve(size * Fixed::bytes);
+        for(size_t done = 0; done < size; ) {
+            size_t n = std::min(size - done, std::max<size_t>(1, buf.available() / Fixed::bytes));
+            char *dst = buf.claim(n * Fixed::bytes);
+            for(size_t i = 0; i < n; i++)
+                dst = StoreFixed(obj[done + i], dst);
+            done += n;
+        }
+    }
+    /* contiguous elements: one block copy when the encoding is the object representation */
+    template <typename T>
+    void SerializeArray(const T *obj, size_t size, BinaryWriter &buf, std::false_type) {
+        SerializeRecords(obj, size, buf, FixedSize<T>());
+    }
+    template <typename T>
+    void SerializeArray(const T *obj, size_t size, BinaryWriter &buf, std::true_type) {
+        if(buf.raw<T>())
+            buf.write_array(obj, size);
+        else
+            SerializeArray(obj, size, buf, std::false_type());
+    }
     /* Arithmetic */
     template <typename T>
-    ARITHMETIC_TYPE SerializeFrom(const T &obj, stringstream &buf) {
-        buf.write((char*) &obj, sizeof(T));
+    ARITHMETIC_TYPE SerializeFrom(const T &obj, BinaryWriter &buf) {
+        buf.put_number(obj);
     }
     /* string */
     template<typename T>
-    STRING_TYPE SerializeFrom(const T &obj, stringstream &buf) {
+    STRING_TYPE SerializeFrom(const T &obj, BinaryWriter &buf) {
         unsigned int size = obj.size();
-        buf.write((char*) &size, sizeof(size));
+        buf.put_length(size);
         buf.write(obj.c_str(), sizeof(char)*size);
     }
+    /* string view, encoded exactly like string */
+    inline void SerializeFrom(const StringView &obj, BinaryWriter &buf) {
+        unsigned int size = obj.size();
+        buf.put_length(size);
+        buf.write(obj.data(), sizeof(char)*size);
+    }
     /* pair */
     template<typename T1, typename T2>
-    void SerializeFrom(const std::pair<T1, T2> &obj, stringstream &buf) {
+    void SerializeFrom(const std::pair<T1, T2> &obj, BinaryWriter &buf) {
+        if(PutRecord(obj, buf, FixedSize<std::pair<T1, T2>>()))
+            return;
         SerializeFrom(obj.first, buf);
         SerializeFrom(obj.second, buf);
     }
+    /* array: the length is part of the type, so none is written */
+    template <typename T, size_t N>
+    void SerializeFrom(const std::array<T, N> &obj, BinaryWriter &buf) {
+        SerializeArray(obj.data(), N, buf, IsBulkType<T>());
+    }
+    /* tuple */
+    template <typename... Ts, size_t... I>
+    void SerializeTuple(const std::tuple<Ts...> &obj, BinaryWriter &buf, std::index_sequence<I...>) {
+        int arr[] = {0, (SerializeFrom(std::get<I>(obj), buf), 0)...};
+        (void)arr;
+    }
+    template <typename... Ts>
+    void SerializeFrom(const std::tuple<Ts...> &obj, BinaryWriter &buf) {
+        if(!PutRecord(obj, buf, FixedSize<std::tuple<Ts...>>()))
+            SerializeTuple(obj, buf, std::index_sequence_for<Ts...>());
+    }
     /* vector */
-    template <typename T>
-    void SerializeFrom(const std::vector<T> &obj, stringstream &buf) {
+    template <typename T, typename A>
+    void SerializeFrom(const std::vector<T, A> &obj, BinaryWriter &buf) {
         unsigned int size = obj.size();
-        buf.write((char*) &size, sizeof(size));
-        for(auto& item : obj)
-            SerializeFrom(item, buf);
+        buf.put_length(size);
+        SerializeArray(obj.data(), obj.size(), buf, IsBulkType<T>());
     }
     /* list */
-    template <typename T>
-    void SerializeFrom(const std::list<T> &obj, stringstream &buf) {
+    template <typename T, typename A>
+    void SerializeFrom(const std::list<T, A> &obj, BinaryWriter &buf) {
         unsigned int size = obj.size();
-        buf.write((char*) &size, sizeof(size));
+        buf.put_length(size);
         for(auto& item : obj)
             SerializeFrom(item, buf);
     }
     /* set */
-    template <typename T>
-    void SerializeFrom(const std::set<T> &obj, stringstream &buf) {
+    template <typename T, typename C, typename A>
+    void SerializeFrom(const std::set<T, C, A> &obj, BinaryWriter &buf) {
         unsigned int size = obj.size();
-        buf.write((char*) &size, sizeof(size));
+        buf.put_length(size);
         for(auto& item : obj)
             SerializeFrom(item, buf);
     }
     /* map */
-    template <typename T1, typename T2>
-    void SerializeFrom(const std::map<T1, T2> &obj, stringstream &buf) {
+    template <typename T1, typename T2, typename C, typename A>
+    void SerializeFrom(const std::map<T1, T2, C, A> &obj, BinaryWriter &buf) {
         unsigned int size = obj.size();
-        buf.write((char*) &size, sizeof(size));
+        buf.put_length(size);
         for(auto& item : obj)
-            SerializeFrom<T1, T2>(item, buf);
+            SerializeFrom(item, buf);
     }
     /* bonus: unique_ptr */
     template <typename T>
-    void SerializeFrom(const std::unique_ptr<T> &obj, stringstream &buf) {
+    void SerializeFrom(const std::unique_ptr<T> &obj, BinaryWriter &buf) {
         SerializeFrom(*obj, buf);
     }
+    /* Mode::TrackShared reference: 0 for null, 1 followed by the object the
+       first time it is reached, id + 2 every time after that */
+    template <typename T>
+    void SerializeShared(const T *obj, BinaryWriter &buf) {
+        unsigned int id;
+        if(!obj)
+            buf.put_length(0u);
+        else if(buf.shared_seen(obj, id))
+            buf.put_length(id + 2);
+        else {
+            buf.put_length(1u);
+            SerializeFrom(*obj, buf);
+        }
+    }
     /* bonus: shared_ptr */
     template <typename T>
-    void SerializeFrom(const std::shared_ptr<T> &obj, stringstream &buf) {
-        SerializeFrom(*obj, buf);
+    void SerializeFrom(const std::shared_ptr<T> &obj, BinaryWriter &buf) {
+        if(buf.tracks_shared())
+            SerializeShared(obj.get(), buf);
+        else
+            SerializeFrom(*obj, buf);
+    }
+    /* weak_ptr: a back-reference, or null once expired */
+    template <typename T>
+    void SerializeFrom(const std::weak_ptr<T> &obj, BinaryWriter &buf) {
+        if(!buf.tracks_shared())
+            throw std::logic_error("binSerialization: weak_ptr needs Mode::TrackShared");
+        SerializeShared(obj.lock().get(), buf);
     }
     /* basic_ptr */
     template <typename T>
-    void SerializeFrom(T *const &obj, stringstream &buf, size_t size) {
-        buf.write((char*) &size, sizeof(size));
-        for(size_t i = 0; i < size; i++)
-            SerializeFrom(*(obj+i), buf);
+    void SerializeFrom(T *const &obj, BinaryWriter &buf, size_t size) {
+        buf.put_length(size);
+        SerializeArray(obj, size, buf, IsBulkType<T>());
+    }
+    /* user defined type declared with SERIALIZE_FIELDS */
+    template <typename T, typename Tuple, size_t... I>
+    void SerializeFields(const T &obj, const Tuple &members, BinaryWriter &buf, std::index_sequence<I...>) {
+        int arr[] = {0, (SerializeFrom(obj.*std::get<I>(members), buf), 0)...};
+        (void)arr;
+    }
+    template <typename T>
+    void SerializeStruct(const T &obj, BinaryWriter &buf, std::false_type) {
+        SerializeFields(obj, Fields<T>::members(), buf, std::make_index_sequence<std::tuple_size<decltype(Fields<T>::members())>::value>());
+    }
+    template <typename T>
+    void SerializeStruct(const T &obj, BinaryWriter &buf, std::true_type) {
+        if(buf.raw<T>())
+            buf.write_array(&obj, 1);
+        else
+            SerializeStruct(obj, buf, std::false_type());
+    }
+    template <typename T>
+    FIELDS_TYPE SerializeFrom(const T &obj, BinaryWriter &buf) {
+        SerializeStruct(obj, buf, IsBulkType<T>());
     }
     /* unique_ptr overload */
     template <typename T>
-    void SerializeFrom(const std::unique_ptr<T[]> &obj, stringstream &buf, size_t size) {
-        buf.write((char*) &size, sizeof(size));
-        for(size_t i = 0; i < size;i ++)
-            SerializeFrom(obj[i], buf);
+    void SerializeFrom(const std::unique_ptr<T[]> &obj, BinaryWriter &buf, size_t size) {
+        buf.put_length(size);
+        SerializeArray(obj.get(), size, buf, IsBulkType<T>());
     }
     /* shared_ptr overload */
     template <typename T>
-    void SerializeFrom(const std::shared_ptr<T[]> &obj, stringstream &buf, size_t size) {
-        buf.write((char*)&size, sizeof(size));
-        for(size_t i = 0; i < size;i ++)
-            SerializeFrom(obj[i], buf);
+    void SerializeFrom(const std::shared_ptr<T[]> &obj, BinaryWriter &buf, size_t size) {
+        buf.put_length(size);
+        SerializeArray(obj.get(), size, buf, IsBulkType<T>());
+    }
+
+    /* encoded size, mirrors the SerializeFrom overloads above; exact except
+       for shared_ptr and weak_ptr under Mode::TrackShared, see SizeCalc */
+    template <typename T, typename Enable>
+    struct FixedSize : std::false_type {};
+    template <typename T>
+    struct FixedSize<T, ARITHMETIC_TYPE> : std::true_type {
+        static constexpr size_t bytes = sizeof(T);
+        static constexpr bool varint = VarintType<T>::value;
+        static char* Store(const T &obj, char *dst) {
+            std::memcpy(dst, &obj, sizeof(T));
+            return dst + sizeof(T);
+        }
+        static const char* Load(T &obj, const char *src) {
+            LoadValue(obj, src);
+            return src + sizeof(T);
+        }
+    };
+    template <typename T1, typename T2>
+    struct FixedSize<std::pair<T1, T2>, typename std::enable_if<FixedSize<T1>::value && FixedSize<T2>::value>::type> : std::true_type {
+        static constexpr size_t bytes = FixedSize<T1>::bytes + FixedSize<T2>::bytes;
+        static constexpr bool varint = FixedSize<T1>::varint || FixedSize<T2>::varint;
+        static char* Store(const std::pair<T1, T2> &obj, char *dst) {
+            return StoreFixed(obj.second, StoreFixed(obj.first, dst));
+        }
+        static const char* Load(std::pair<T1, T2> &obj, const char *src) {
+            return LoadFixed(obj.second, LoadFixed(obj.first, src));
+        }
+    };
+    template <typename T, size_t N>
+    struct FixedSize<std::array<T, N>, typename std::enable_if<FixedSize<T>::value>::type> : std::true_type {
+        static constexpr size_t bytes = N * FixedSize<T>::bytes;
+        static constexpr bool varint = FixedSize<T>::varint;
+        static char* Store(const std::array<T, N> &obj, char *dst) {
+            for(auto& item : obj)
+                dst = StoreFixed(item, dst);
+            return dst;
+        }
+        static const char* Load(std::array<T, N> &obj, const char *src) {
+            for(auto& item : obj)
+                src = LoadFixed(item, src);
+            return src;
+        }
+    };
+    template <typename... Ts>
+    struct FixedSize<std::tuple<Ts...>, typename std::enable_if<AllOf({FixedSize<Ts>::value...})>::type> : std::true_type {
+        static constexpr size_t bytes = SumOf({FixedSize<Ts>::bytes...});
+        static constexpr bool varint = AnyOf({FixedSize<Ts>::varint...});
+        template <size_t... I>
+        static char* Store(const std::tuple<Ts...> &obj, char *dst, std::index_sequence<I...>) {
+            int arr[] = {0, (dst = StoreFixed(std::get<I>(obj), dst), 0)...};
+            (void)arr;
+            return dst;
+        }
+        template <size_t... I>
+        static const char* Load(std::tuple<Ts...> &obj, const char *src, std::index_sequence<I...>) {
+            int arr[] = {0, (src = LoadFixed(std::get<I>(obj), src), 0)...};
+            (void)arr;
+            return src;
+        }
+        static char* Store(const std::tuple<Ts...> &obj, char *dst) {
+            return Store(obj, dst, std::index_sequence_for<Ts...>());
+        }
+        static const char* Load(std::tuple<Ts...> &obj, const char *src) {
+            return Load(obj, src, std::index_sequence_for<Ts...>());
+        }
+    };
+
+    template <typename T, bool = FixedSize<T>::value>
+    struct FixedField {
+        static constexpr size_t bytes = 0;
+        static constexpr bool varint = false;
+    };
+    template <typename T>
+    struct FixedField<T, true> {
+        static constexpr size_t bytes = FixedSize<T>::bytes;
+        static constexpr bool varint = FixedSize<T>::varint;
+    };
+    template <typename Tuple>
+    struct FixedFields;
+    template <typename... M>
+    struct FixedFields<std::tuple<M...>> {
+        static constexpr bool value = AllOf({FixedSize<typename MemberOf<M>::type>::value...});
+        static constexpr size_t bytes = SumOf({FixedField<typename MemberOf<M>::type>::bytes...});
+        static constexpr bool varint = AnyOf({FixedField<typename MemberOf<M>::type>::varint...});
+    };
+    template <typename T>
+    struct FixedSize<T, typename std::enable_if<Fields<T>::value && FixedFields<decltype(Fields<T>::members())>::value>::type>
+        : std::true_type {
+        static constexpr size_t bytes = FixedFields<decltype(Fields<T>::members())>::bytes;
+        static constexpr bool varint = FixedFields<decltype(Fields<T>::members())>::varint;
+        template <typename Tuple, size_t... I>
+        static char* Store(const T &obj, const Tuple &members, char *dst, std::index_sequence<I...>) {
+            int arr[] = {0, (dst = StoreFixed(obj.*std::get<I>(members), dst), 0)...};
+            (void)arr;
+            return dst;
+        }
+        template <typename Tuple, size_t... I>
+        static const char* Load(T &obj, const Tuple &members, const char *src, std::index_sequence<I...>) {
+            int arr[] = {0, (src = LoadFixed(obj.*std::get<I>(members), src), 0)...};
+            (void)arr;
+            return src;
+        }
+        static char* Store(const T &obj, char *dst) {
+            return Store(obj, Fields<T>::members(), dst, std::make_index_sequence<std::tuple_size<decltype(Fields<T>::members())>::value>());
+        }
+        static const char* Load(T &obj, const char *src) {
+            return Load(obj, Fields<T>::members(), src, std::make_index_sequence<std::tuple_size<decltype(Fields<T>::members())>::value>());
+        }
+    };
+    /* bytes per element at a fixed stride, or 0 when elements vary in size */
+    template <typename T>
+    constexpr size_t RecordStride(Mode mode, std::true_type) {
+        return HasMode(mode, Mode::Compact) && FixedSize<T>::varint ? 0 : FixedSize<T>::bytes;
+    }
+    template <typename T>
+    constexpr size_t RecordStride(Mode, std::false_type) {
+        return 0;
+    }
+    template <typename T>
+    constexpr size_t RecordStride(Mode mode) {
+        return RecordStride<T>(mode, FixedSize<T>());
+    }
+
+    template <typename L>
+    constexpr size_t LengthSize(L n, Mode mode) {
+        return HasMode(mode, Mode::Compact) ? VarintSize(n) : sizeof(L);
+    }
+
+    template <typename T, typename Enable = void>
+    struct SizeCalc;
+    template <typename T>
+    constexpr size_t SerializedSize(const T &obj, Mode mode = Mode::Default) {
+        return SizeCalc<T>::Get(obj, mode);
+    }
+    template <typename T>
+    size_t SerializedSize(const T *obj, size_t size, Mode mode = Mode::Default) {
+        return LengthSize(size, mode) + SizeCalc<const T*>::Elements(obj, obj + size, mode);
+    }
+    template <typename T>
+    size_t SerializedSize(const std::unique_ptr<T[]> &obj, size_t size, Mode mode = Mode::Default) {
+        return SerializedSize(static_cast<const T*>(obj.get()), size, mode);
+    }
+    template <typename T>
+    size_t SerializedSize(const std::shared_ptr<T[]> &obj, size_t size, Mode mode = Mode::Default) {
+        return SerializedSize(static_cast<const T*>(obj.get()), size, mode);
+    }
+
+    /* Arithmetic: folded at compile time, except varint integers in Mode::Compact */
+    template <typename T>
+    constexpr size_t NumberSize(const T &obj, Mode mode, std::true_type) {
+        return HasMode(mode, Mode::Compact) ? VarintSize(ToVarint(obj)) : sizeof(T);
+    }
+    template <typename T>
+    constexpr size_t NumberSize(const T&, Mode, std::false_type) {
+        return sizeof(T);
+    }
+    template <typename T>
+    struct SizeCalc<T, ARITHMETIC_TYPE> {
+        static constexpr size_t Get(const T &obj, Mode mode = Mode::Default) {
+            return NumberSize(obj, mode, VarintType<T>());
+        }
+    };
+    /* string */
+    template <typename T>
+    struct SizeCalc<T, STRING_TYPE> {
+        static size_t Get(const T &obj, Mode mode = Mode::Default) {
+            return LengthSize(static_cast<unsigned int>(obj.size()), mode) + obj.size();
+        }
+    };
+    template <>
+    struct SizeCalc<StringView> {
+        static size_t Get(const StringView &obj, Mode mode = Mode::Default) {
+            return LengthSize(static_cast<unsigned int>(obj.size()), mode) + obj.size();
+        }
+    };
+    /* pair */
+    template <typename T1, typename T2>
+    struct SizeCalc<std::pair<T1, T2>> {
+        static constexpr size_t Get(const std::pair<T1, T2> &obj, Mode mode = Mode::Default) {
+            return SerializedSize(obj.first, mode) + SerializedSize(obj.second, mode);
+        }
+    };
+    /* element ranges shared by containers and pointers */
+    template <typename Iter>
+    size_t ElementsSize(Iter first, Iter last, Mode mode, std::false_type) {
+        size_t bytes = 0;
+        for(; first != last; ++first)
+            bytes += SerializedSize(*first, mode);
+        return bytes;
+    }
+    template <typename Iter>
+    size_t ElementsSize(Iter first, Iter last, Mode mode, std::true_type) {
+        typedef FixedSize<typename std::iterator_traits<Iter>::value_type> Fixed;
+        if(HasMode(mode, Mode::Compact) && Fixed::varint)
+            return ElementsSize(first, last, mode, std::false_type());
+        return std::distance(first, last) * Fixed::bytes;
+    }
+    template <typename T>
+    struct SizeCalc<const T*> {
+        static size_t Elements(const T *first, const T *last, Mode mode) {
+            return ElementsSize(first, last, mode, FixedSize<T>());
+        }
+    };
+    /* array, tuple */
+    template <typename T, size_t N>
+    struct SizeCalc<std::array<T, N>> {
+        static size_t Get(const std::array<T, N> &obj, Mode mode) {
+            return ElementsSize(obj.begin(), obj.end(), mode, FixedSize<T>());
+        }
+    };
+    template <typename... Ts>
+    struct SizeCalc<std::tuple<Ts...>> {
+        template <size_t... I>
+        static size_t Sum(const std::tuple<Ts...> &obj, Mode mode, std::index_sequence<I...>) {
+            size_t bytes = 0;
+            int arr[] = {0, (bytes += SerializedSize(std::get<I>(obj), mode), 0)...};
+            (void)arr;
+            return bytes;
+        }
+        static size_t Get(const std::tuple<Ts...> &obj, Mode mode) {
+            return Sum(obj, mode, std::index_sequence_for<Ts...>());
+        }
+    };
+    /* vector, list, set, map */
+    template <typename C>
+    size_t ContainerSize(const C &obj, Mode mode) {
+        return LengthSize(static_cast<unsigned int>(obj.size()), mode)
+            + ElementsSize(obj.begin(), obj.end(), mode, FixedSize<typename C::value_type>());
+    }
+    template <typename T, typename A>
+    struct SizeCalc<std::vector<T, A>> {
+        static size_t Get(const std::vector<T, A> &obj, Mode mode) { return ContainerSize(obj, mode); }
+    };
+    template <typename T, typename A>
+    struct SizeCalc<std::list<T, A>> {
+        static size_t Get(const std::list<T, A> &obj, Mode mode) { return ContainerSize(obj, mode); }
+    };
+    template <typename T, typename C, typename A>
+    struct SizeCalc<std::set<T, C, A>> {
+        static size_t Get(const std::set<T, C, A> &obj, Mode mode) { return ContainerSize(obj, mode); }
+    };
+    template <typename T1, typename T2, typename C, typename A>
+    struct SizeCalc<std::map<T1, T2, C, A>> {
+        static size_t Get(const std::map<T1, T2, C, A> &obj, Mode mode) { return ContainerSize(obj, mode); }
+    };
+    /* unique_ptr, shared_ptr */
+    template <typename T>
+    struct SizeCalc<std::unique_ptr<T>> {
+        static size_t Get(const std::unique_ptr<T> &obj, Mode mode) { return SerializedSize(*obj, mode); }
+    };
+    /* with Mode::TrackShared only an estimate: a shared_ptr counts the widest
+       tag and its object at every reference, a weak_ptr just the tag, since
+       weak references are normally back edges to objects written elsewhere */
+    template <typename T>
+    struct SizeCalc<std::shared_ptr<T>> {
+        static size_t Get(const std::shared_ptr<T> &obj, Mode mode) {
+            if(HasMode(mode, Mode::TrackShared))
+                return LengthSize(~0u, mode) + (obj ? SerializedSize(*obj, mode) : 0);
+            return SerializedSize(*obj, mode);
+        }
+    };
+    template <typename T>
+    struct SizeCalc<std::weak_ptr<T>> {
+        static size_t Get(const std::weak_ptr<T>&, Mode mode) { return LengthSize(~0u, mode); }
+    };
+
+    /* SERIALIZE_FIELDS types */
+    template <typename T>
+    struct SizeCalc<T, FIELDS_TYPE> {
+        template <typename Tuple, size_t... I>
+        static size_t Sum(const T &obj, const Tuple &members, Mode mode, std::index_sequence<I...>) {
+            size_t bytes = 0;
+            int arr[] = {0, (bytes += SerializedSize(obj.*std::get<I>(members), mode), 0)...};
+            (void)arr;
+            return bytes;
+        }
+        static size_t Get(const T &obj, Mode mode) {
+            return Sum(obj, Fields<T>::members(), mode, std::make_index_sequence<std::tuple_size<decltype(Fields<T>::members())>::value>());
+        }
+    };
+
+    /* window of the stringstream adapters, kept small since a reader reads
+       ahead by up to this much on every call */
+    constexpr size_t kStreamWindow = 4096;
+    /* sink pushing into a stream buffer */
+    class StreamSink : public ByteSink
+    {
+      private:
+        std::streambuf *out;
+      public:
+        explicit StreamSink(std::streambuf *sb) : out(sb) {}
+        void Consume(const char *data, size_t n) override {
+            if(static_cast<size_t>(out->sputn(data, n)) != n)
+                throw std::runtime_error("binSerialization: stream write failed");
+        }
+    };
+    /* stringstream adapters, written through a fixed window */
+    template <typename T>
+    void SerializeFrom(const T &obj, stringstream &buf) {
+        StreamSink sink(buf.rdbuf());
+        BinaryWriter writer(sink, kStreamWindow);
+        SerializeFrom(obj, writer);
+        writer.flush();
+    }
+    template <typename T>
+    void SerializeFrom(const T &obj, stringstream &buf, size_t size) {
+        StreamSink sink(buf.rdbuf());
+        BinaryWriter writer(sink, kStreamWindow);
+        SerializeFrom(obj, writer, size);
+        writer.flush();
     }
 }  // namespace binSerialization
 
 namespace binDeserialization {
+    /* one record from a single bounds check */
+    template <typename T>
+    bool GetRecord(T &obj, BinaryReader &buf, std::true_type) {
+        typedef binSerialization::FixedSize<T> Fixed;
+        if(buf.compact() && Fixed::varint)
+            return false;
+        binSerialization::LoadFixed(obj, buf.take(Fixed::bytes));
+        return true;
+    }
+    template <typename T>
+    bool GetRecord(T&, BinaryReader&, std::false_type) {
+        return false;
+    }
+    /* records at a precomputed stride, bounds checked per batch */
+    template <typename T>
+    void DeserializeRecords(T *obj, size_t size, BinaryReader &buf, std::false_type) {
+        for(size_t i = 0; i < size; i++)
+            DeserializeTo(obj[i], buf);
+    }
+    template <typename T>
+    void DeserializeRecords(T *obj, size_t size, BinaryReader &buf, std::true_type) {
+        typedef binSerialization::FixedSize<T> Fixed;
+        if((buf.compact() && Fixed::varint) || !Fixed::bytes)
+            return DeserializeRecords(obj, size, buf, std::false_type());
+        buf.require_items(size, Fixed::bytes);
+        for(size_t done = 0; done < size; ) {
+            size_t n = std::min(size - done, std::max<size_t>(1, buf.remaining() / Fixed::bytes));
+            const char *src = buf.take(n * Fixed::bytes);
+            for(size_t i = 0; i < n; i++)
+                src = binSerialization::LoadFixed(obj[done + i], src);
+            done += n;
+        }
+    }
+    /* a fresh element for a container using alloc; allocator-aware elements
+       (strings, nested containers) take it, so a tree decoded into an arena
+       stays in that arena */
+    template <typename T, typename A>
+    T MakeElement(const A &alloc, std::true_type) {
+        return T(alloc);
+    }
+    template <typename T, typename A>
+    T MakeElement(const A &, std::false_type) {
+        return T();
+    }
+    template <typename T, typename A>
+    T MakeElement(const A &alloc) {
+        return MakeElement<T>(alloc, std::integral_constant<bool, std::uses_allocator<T, A>::value && std::is_constructible<T, const A&>::value>());
+    }
+    /* contiguous elements: one block copy when the encoding is the object representation */
+    template <typename T>
+    void DeserializeArray(T *obj, size_t size, BinaryReader &buf, std::false_type) {
+        DeserializeRecords(obj, size, buf, binSerialization::FixedSize<T>());
+    }
+    template <typename T>
+    void DeserializeArray(T *obj, size_t size, BinaryReader &buf, std::true_type) {
+        if(buf.raw<T>())
+            buf.read_array(obj, size);
+        else
+            DeserializeArray(obj, size, buf, std::false_type());
+    }
+    /* sizes obj for elements of at least width bytes and decodes them. A
+       streaming reader whose source size is unknown cannot refuse a forged
+       count up front, so it grows one window of elements at a time instead */
+    template <typename T, typename A, typename F>
+    void ResizeAndDecode(std::vector<T, A> &obj, size_t size, size_t width, BinaryReader &buf, F decode) {
+        buf.require_items(size, width);
+        size_t step = buf.streaming() ? std::max<size_t>(1, binSerialization::kChunkSize / width) : size;
+        size_t done = 0;
+        do {
+            size_t n = std::min(size - done, step);
+            obj.resize(done + n);
+            decode(obj.data() + done, n);
+            done += n;
+        } while(done < size);
+    }
+    template <typename T, typename A>
+    void DeserializeVector(std::vector<T, A> &obj, size_t size, BinaryReader &buf, std::true_type) {
+        ResizeAndDecode(obj, size, buf.raw<T>() ? sizeof(T) : 1, buf, [&buf](T *dst, size_t n) {
+            DeserializeArray(dst, n, buf, std::true_type());
+        });
+    }
+    template <typename T, typename A>
+    void DeserializeVector(std::vector<T, A> &obj, size_t size, BinaryReader &buf, std::false_type) {
+        if(size_t stride = binSerialization::RecordStride<T>(buf.mode())) {
+            ResizeAndDecode(obj, size, stride, buf, [&buf](T *dst, size_t n) {
+                DeserializeRecords(dst, n, buf, binSerialization::FixedSize<T>());
+            });
+            return;
+        }
+        /* elements already there (Mode::ReuseInPlace) are decoded over, keeping their buffers */
+        size_t kept = std::min(obj.size(), size);
+        obj.resize(kept);
+        DeserializeRecords(obj.data(), kept, buf, std::false_type());
+        /* every encoded element takes at least one byte */
+        obj.reserve(kept + std::min(size - kept, buf.remaining()));
+        for(size_t i = kept; i < size; i++) {
+            T item = MakeElement<T>(obj.get_allocator());
+            DeserializeTo(item, buf);
+            obj.push_back(std::move(item));
+        }
+    }
     /* Arithmetic */
     template <typename T>
-    ARITHMETIC_TYPE DeserializeTo(T &obj, stringstream &buf) {
-        buf.read((char*)&obj, sizeof(T));
+    ARITHMETIC_TYPE DeserializeTo(T &obj, BinaryReader &buf) {
+        buf.get_number(obj);
     }
     /* string */
     template<typename T>
-    STRING_TYPE DeserializeTo(T &obj, stringstream &buf) {
+    STRING_TYPE DeserializeTo(T &obj, BinaryReader &buf) {
         unsigned int size;
-        buf.read((char*) &size, sizeof(size));
+        buf.get_length(size);
+        buf.require_items(size, 1);
         obj.resize(size);
-        buf.read(const_cast<char*>(obj.c_str()), sizeof(char)*size);
+        buf.read(&obj[0], sizeof(char)*size);
     }    
+    /* string view into the reader's buffer: no allocation and no copy, valid
+       only as long as the buffer. A streaming reader refills its window, so
+       it cannot hand out views. */
+    inline void DeserializeTo(StringView &obj, BinaryReader &buf) {
+        if(buf.streaming())
+            throw std::logic_error("binDeserialization: string views need an in-memory reader");
+        unsigned int size;
+        buf.get_length(size);
+        obj = StringView(buf.peek(size), size);
+        buf.skip(size);
+    }
     /* pair */
     template<typename T1, typename T2>
-    void DeserializeTo(std::pair<T1, T2> &obj, stringstream &buf) {
+    void DeserializeTo(std::pair<T1, T2> &obj, BinaryReader &buf) {
+        if(GetRecord(obj, buf, binSerialization::FixedSize<std::pair<T1, T2>>()))
+            return;
         DeserializeTo(obj.first, buf);
         DeserializeTo(obj.second, buf);
     }
+    /* array */
+    template <typename T, size_t N>
+    void DeserializeTo(std::array<T, N> &obj, BinaryReader &buf) {
+        DeserializeArray(obj.data(), N, buf, IsBulkType<T>());
+    }
+    /* tuple */
+    template <typename... Ts, size_t... I>
+    void DeserializeTuple(std::tuple<Ts...> &obj, BinaryReader &buf, std::index_sequence<I...>) {
+        int arr[] = {0, (DeserializeTo(std::get<I>(obj), buf), 0)...};
+        (void)arr;
+    }
+    template <typename... Ts>
+    void DeserializeTo(std::tuple<Ts...> &obj, BinaryReader &buf) {
+        if(!GetRecord(obj, buf, binSerialization::FixedSize<std::tuple<Ts...>>()))
+            DeserializeTuple(obj, buf, std::index_sequence_for<Ts...>());
+    }
     /* vector */
-    template <typename T>
-    void DeserializeTo(std::vector<T> &obj, stringstream &buf) {
+    template <typename T, typename A>
+    void DeserializeTo(std::vector<T, A> &obj, BinaryReader &buf) {
         unsigned int size;
-        obj.clear();
-        buf.read((char*) &size, sizeof(size));
-        for(unsigned int i = 0; i < size; i++) {
-            T item;
-            DeserializeTo(item, buf);
-            obj.push_back(item);
-        }
+        if(!buf.reuses())
+            obj.clear();
+        buf.get_length(size);
+        DeserializeVector(obj, size, buf, IsBulkType<T>());
     }
     /* list */
-    template <typename T>
-    void DeserializeTo(std::list<T> &obj, stringstream &buf) {
+    template <typename T, typename A>
+    void DeserializeTo(std::list<T, A> &obj, BinaryReader &buf) {
         unsigned int size = 0; 
-        buf.read((char*) &size, sizeof(size));
+        buf.get_length(size);
+        buf.require_items(size, 1);
         obj.resize(size);
         
         for(auto& item : obj)
             DeserializeTo(item, buf);
     }
     /* set */
-    template <typename T>
-    void DeserializeTo(std::set<T> &obj, stringstream &buf) {
+    template <typename T, typename C, typename A>
+    void DeserializeTo(std::set<T, C, A> &obj, BinaryReader &buf) {
         unsigned int size;
-        obj.clear();
-        buf.read((char*) &size, sizeof(size));
+        if(!buf.reuses())
+            obj.clear();
+        buf.get_length(size);
+        /* input is sorted: inserting at the hint is amortised O(1), and with
+           Mode::ReuseInPlace the nodes of keys that come again are kept */
+        auto next = obj.begin();
+        auto less = obj.key_comp();
         for(unsigned int i = 0; i < size; i++) {
-            T item;
+            T item = MakeElement<T>(obj.get_allocator());
             DeserializeTo(item, buf);
-            obj.insert(item);
+            while(next != obj.end() && less(*next, item))
+                next = obj.erase(next);
+            if(next != obj.end() && !less(item, *next))
+                ++next;
+            else
+                obj.emplace_hint(next, std::move(item));
         }
+        obj.erase(next, obj.end());
     }
     /* map */
-    template <typename T1, typename T2>
-    void DeserializeTo(std::map<T1, T2> &obj, stringstream &buf) {
+    template <typename T1, typename T2, typename C, typename A>
+    void DeserializeTo(std::map<T1, T2, C, A> &obj, BinaryReader &buf) {
         unsigned int size;
-        buf.read((char*)&size, sizeof(unsigned int));
+        if(!buf.reuses())
+            obj.clear();
+        buf.get_length(size);
+        /* as for set; a kept node has its value decoded in place */
+        auto next = obj.begin();
+        auto less = obj.key_comp();
+        T1 item1 = MakeElement<T1>(obj.get_allocator());
         for(unsigned int i=0; i < size; i++) {
-            T1 item1;
-            T2 item2;
             DeserializeTo(item1, buf);
-            DeserializeTo(item2, buf);
-            obj.insert({item1, item2});
+            while(next != obj.end() && less(next->first, item1))
+                next = obj.erase(next);
+            if(next != obj.end() && !less(item1, next->first)) {
+                DeserializeTo(next->second, buf);
+                ++next;
+            } else {
+                T2 item2 = MakeElement<T2>(obj.get_allocator());
+                DeserializeTo(item2, buf);
+                obj.emplace_hint(next, std::move(item1), std::move(item2));
+            }
         }
+        obj.erase(next, obj.end());
     }
     /* bonus: unique_ptr */
     template <typename T>
-    void DeserializeTo(std::unique_ptr<T> &obj, stringstream &buf) {
-        obj = std::unique_ptr<T>(new T);
+    void DeserializeTo(std::unique_ptr<T> &obj, BinaryReader &buf) {
+        if(!buf.reuses() || !obj)
+            obj = std::unique_ptr<T>(new T);
         DeserializeTo(*obj, buf);
     }
+    /* Mode::TrackShared reference; a new object is registered before its
+       contents are read, so references back to it from inside resolve */
+    template <typename T>
+    void DeserializeShared(std::shared_ptr<T> &obj, BinaryReader &buf) {
+        unsigned int tag;
+        buf.get_length(tag);
+        if(tag == 0) {
+            obj.reset();
+        } else if(tag == 1) {
+            obj = std::shared_ptr<T>(new T);
+            buf.share(obj);
+            DeserializeTo(*obj, buf);
+        } else {
+            obj = buf.shared_at<T>(tag - 2);
+        }
+    }
     /* bonus: shared_ptr */
     template <typename T>
-    void DeserializeTo(std::shared_ptr<T> &obj, stringstream &buf) {
-        obj = std::shared_ptr<T>(new T);
+    void DeserializeTo(std::shared_ptr<T> &obj, BinaryReader &buf) {
+        if(buf.tracks_shared()) {
+            DeserializeShared(obj, buf);
+            return;
+        }
+        /* a pointee seen by other owners is replaced, not overwritten */
+        if(!buf.reuses() || obj.use_count() != 1)
+            obj = std::shared_ptr<T>(new T);
         DeserializeTo(*obj, buf);
     }
+    /* weak_ptr: stays valid while some shared_ptr in the result owns the object */
+    template <typename T>
+    void DeserializeTo(std::weak_ptr<T> &obj, BinaryReader &buf) {
+        if(!buf.tracks_shared())
+            throw std::logic_error("binDeserialization: weak_ptr needs Mode::TrackShared");
+        std::shared_ptr<T> target;
+        DeserializeShared(target, buf);
+        obj = target;
+    }
     /* basic_ptr */
     template <typename T>
-    void DeserializeTo(T *&obj, stringstream &buf) {
+    size_t GetArrayLength(BinaryReader &buf) {
         size_t size;
-        buf.read((char*) &size, sizeof(size));
+        buf.get_length(size);
+        buf.require_items(size, buf.raw<T>() ? sizeof(T) : 1);
+        return size;
+    }
+    template <typename T>
+    void DeserializeTo(T *&obj, BinaryReader &buf) {
+        size_t size = GetArrayLength<T>(buf);
         obj = new T[size];
-        for(size_t i = 0 ;i < size; i++)
-            DeserializeTo(*(obj+i), buf);
+        DeserializeArray(obj, size, buf, IsBulkType<T>());
+    }
+    /* into a caller-owned buffer of capacity elements, nothing allocated;
+       returns the number of elements decoded */
+    template <typename T>
+    size_t DeserializeInto(T *obj, size_t capacity, BinaryReader &buf) {
+        size_t size = GetArrayLength<T>(buf);
+        if(size > capacity)
+            throw std::length_error("binDeserialization: array larger than the buffer given");
+        DeserializeArray(obj, size, buf, IsBulkType<T>());
+        return size;
     }
     /* unique_ptr overload */
+    template <typename T>
+    void DeserializeTo(std::unique_ptr<T[]> &obj, BinaryReader &buf) {
+        size_t size = GetArrayLength<T>(buf);
+        obj.reset(new T[size]);
+        DeserializeArray(obj.get(), size, buf, IsBulkType<T>());
+    }
+    /* shared_ptr overload */
+    template <typename T>
+    void DeserializeTo(std::shared_ptr<T[]> &obj, BinaryReader &buf) {
+        size_t size = GetArrayLength<T>(buf);
+        obj.reset(new T[size], std::default_delete<T[]>());
+        DeserializeArray(obj.get(), size, buf, IsBulkType<T>());
+    }
 
+    /* user defined type declared with SERIALIZE_FIELDS */
+    template <typename T, typename Tuple, size_t... I>
+    void DeserializeFields(T &obj, const Tuple &members, BinaryReader &buf, std::index_sequence<I...>) {
+        int arr[] = {0, (DeserializeTo(obj.*std::get<I>(members), buf), 0)...};
+        (void)arr;
+    }
+    template <typename T>
+    void DeserializeStruct(T &obj, BinaryReader &buf, std::false_type) {
+        typedef binSerialization::Fields<T> Members;
+        DeserializeFields(obj, Members::members(), buf, std::make_index_sequence<std::tuple_size<decltype(Members::members())>::value>());
+    }
+    template <typename T>
+    void DeserializeStruct(T &obj, BinaryReader &buf, std::true_type) {
+        if(buf.raw<T>())
+            buf.read_array(&obj, 1);
+        else
+            DeserializeStruct(obj, buf, std::false_type());
+    }
+    template <typename T>
+    FIELDS_TYPE DeserializeTo(T &obj, BinaryReader &buf) {
+        DeserializeStruct(obj, buf, IsBulkType<T>());
+    }
+
+    /* source pulling from a stream buffer */
+    class StreamSource : public ByteSource
+    {
+      private:
+        std::streambuf *in;
+      public:
+        explicit StreamSource(std::streambuf *sb) : in(sb) {}
+        size_t Produce(char *dst, size_t n) override {
+            return static_cast<size_t>(in->sgetn(dst, n));
+        }
+    };
+    /* stringstream adapter: decodes from the read position of buf and leaves
+       it just past the object, or where it was if decoding fails */
+    template <typename T>
+    void DeserializeTo(T &obj, stringstream &buf) {
+        std::streampos start = buf.tellg();
+        if(start == std::streampos(-1))
+            throw std::out_of_range("binDeserialization: stream has no read position");
+        StreamSource source(buf.rdbuf());
+        BinaryReader reader(source, binSerialization::kStreamWindow);
+        try {
+            DeserializeTo(obj, reader);
+        } catch(...) {
+            buf.seekg(start);
+            throw;
+        }
+        buf.seekg(start + std::streamoff(reader.position()));
+    }
 }  // namespace binDeserialization
 
 #endif
\ No newline at end of file
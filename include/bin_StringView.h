@@ -0,0 +1,62 @@
+#ifndef __bin_StringView_HEADER__
+#define __bin_StringView_HEADER__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+namespace binSerialization {
+#if __cplusplus >= 201703L
+    typedef std::string_view StringView;
+#else
+    /* non-owning characters, the subset of std::string_view used here */
+    class StringView
+    {
+      private:
+        const char *ptr;
+        size_t len;
+      public:
+        constexpr StringView() : ptr(nullptr), len(0) {}
+        constexpr StringView(const char *data, size_t size) : ptr(data), len(size) {}
+        StringView(const char *str) : ptr(str), len(std::strlen(str)) {}
+        StringView(const std::string &str) : ptr(str.data()), len(str.size()) {}
+        explicit operator std::string() const {
+            return std::string(ptr, len);
+        }
+        constexpr const char* data() const { return ptr; }
+        constexpr size_t size() const { return len; }
+        constexpr size_t length() const { return len; }
+        constexpr bool empty() const { return len == 0; }
+        constexpr const char* begin() const { return ptr; }
+        constexpr const char* end() const { return ptr + len; }
+        constexpr const char& operator[](size_t i) const { return ptr[i]; }
+        int compare(StringView other) const {
+            size_t n = std::min(len, other.len);
+            int diff = n ? std::memcmp(ptr, other.ptr, n) : 0;
+            if(diff)
+                return diff;
+            return len < other.len ? -1 : (len > other.len ? 1 : 0);
+        }
+        friend bool operator==(StringView a, StringView b) { return a.len == b.len && a.compare(b) == 0; }
+        friend bool operator!=(StringView a, StringView b) { return !(a == b); }
+        friend bool operator<(StringView a, StringView b) { return a.compare(b) < 0; }
+        friend bool operator>(StringView a, StringView b) { return b < a; }
+        friend bool operator<=(StringView a, StringView b) { return !(b < a); }
+        friend bool operator>=(StringView a, StringView b) { return !(a < b); }
+        friend std::ostream& operator<<(std::ostream &os, StringView v) {
+            return os.write(v.ptr, v.len);
+        }
+    };
+#endif
+}  // namespace binSerialization
+
+namespace binDeserialization {
+    using binSerialization::StringView;
+}  // namespace binDeserialization
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef __lazy_Serialization_HEADER__
+#define __lazy_Serialization_HEADER__
+
+#include "parallel_Serialization.h"
+#include <iterator>
+
+namespace binDeserialization {
+    /* steps over one encoded value without materializing it, mirrors the
+       DeserializeTo overloads */
+    template <typename T, typename Enable = void>
+    struct SkipCalc;
+    template <typename T>
+    void SkipOver(BinaryReader &buf) {
+        SkipCalc<T>::Skip(buf);
+    }
+    /* n consecutive elements; fixed-width ones in a single step */
+    template <typename T>
+    void SkipElements(size_t n, BinaryReader &buf, std::false_type) {
+        for(size_t i = 0; i < n; i++)
+            SkipOver<T>(buf);
+    }
+    template <typename T>
+    void SkipElements(size_t n, BinaryReader &buf, std::true_type) {
+        typedef binSerialization::FixedSize<T> Fixed;
+        if(buf.compact() && Fixed::varint)
+            return SkipElements<T>(n, buf, std::false_type());
+        buf.require_items(n, Fixed::bytes);
+        buf.skip(n * Fixed::bytes);
+    }
+    /* Arithmetic */
+    template <typename T>
+    struct SkipCalc<T, ARITHMETIC_TYPE> {
+        static void Skip(BinaryReader &buf) {
+            if(buf.compact() && VarintType<T>::value)
+                buf.get_varint();
+            else
+                buf.skip(sizeof(T));
+        }
+    };
+    /* string */
+    template <typename T>
+    struct SkipCalc<T, STRING_TYPE> {
+        static void Skip(BinaryReader &buf) {
+            unsigned int size;
+            buf.get_length(size);
+            buf.skip(size);
+        }
+    };
+    /* pair */
+    template <typename T1, typename T2>
+    struct SkipCalc<std::pair<T1, T2>> {
+        static void Skip(BinaryReader &buf) {
+            SkipOver<T1>(buf);
+            SkipOver<T2>(buf);
+        }
+    };
+    /* array, tuple */
+    template <typename T, size_t N>
+    struct SkipCalc<std::array<T, N>> {
+        static void Skip(BinaryReader &buf) { SkipElements<T>(N, buf, binSerialization::FixedSize<T>()); }
+    };
+    template <typename... Ts>
+    struct SkipCalc<std::tuple<Ts...>> {
+        static void Skip(BinaryReader &buf) {
+            int arr[] = {0, (SkipOver<Ts>(buf), 0)...};
+            (void)arr;
+        }
+    };
+    /* vector, list, set, map */
+    template <typename T>
+    void SkipContainer(BinaryReader &buf) {
+        unsigned int size;
+        buf.get_length(size);
+        SkipElements<T>(size, buf, binSerialization::FixedSize<T>());
+    }
+    template <typename T, typename A>
+    struct SkipCalc<std::vector<T, A>> {
+        static void Skip(BinaryReader &buf) { SkipContainer<T>(buf); }
+    };
+    template <typename T, typename A>
+    struct SkipCalc<std::list<T, A>> {
+        static void Skip(BinaryReader &buf) { SkipContainer<T>(buf); }
+    };
+    template <typename T, typename C, typename A>
+    struct SkipCalc<std::set<T, C, A>> {
+        static void Skip(BinaryReader &buf) { SkipContainer<T>(buf); }
+    };
+    template <typename T1, typename T2, typename C, typename A>
+    struct SkipCalc<std::map<T1, T2, C, A>> {
+        static void Skip(BinaryReader &buf) { SkipContainer<std::pair<T1, T2>>(buf); }
+    };
+    /* unique_ptr, shared_ptr */
+    template <typename T>
+    struct SkipCalc<std::unique_ptr<T>> {
+        static void Skip(BinaryReader &buf) { SkipOver<T>(buf); }
+    };
+    template <typename T>
+    struct SkipCalc<std::shared_ptr<T>> {
+        static void Skip(BinaryReader &buf) { SkipOver<T>(buf); }
+    };
+    /* SERIALIZE_FIELDS types */
+    template <typename Tuple>
+    struct SkipFields;
+    template <typename... M>
+    struct SkipFields<std::tuple<M...>> {
+        static void Skip(BinaryReader &buf) {
+            int arr[] = {0, (SkipOver<typename binSerialization::MemberOf<M>::type>(buf), 0)...};
+            (void)arr;
+        }
+    };
+    template <typename T>
+    struct SkipCalc<T, FIELDS_TYPE> {
+        static void Skip(BinaryReader &buf) {
+            if(buf.raw<T>())
+                buf.skip(sizeof(T));
+            else
+                SkipFields<decltype(binSerialization::Fields<T>::members())>::Skip(buf);
+        }
+    };
+
+    /* read-only view of an encoded vector<T> that decodes elements on demand.
+       Element offsets come from the stride for fixed-width elements, from the
+       chunk index of an indexed vector, or from one skip pass otherwise. The
+       bytes must outlive the view unless it was opened from a path. */
+    template <typename T>
+    class LazyVector
+    {
+      private:
+        std::unique_ptr<MappedFile> file;
+        const char *base;            // first element
+        size_t payload;              // bytes of all elements
+        size_t count;
+        size_t stride;               // element width when fixed, else 0
+        size_t every;                // elements per entry of offsets
+        std::vector<uint64_t> offsets;
+        Mode mode_;
+
+        void Open(const char *data, size_t len, bool indexed) {
+            if(HasMode(mode_, Mode::TrackShared))
+                throw std::logic_error("binDeserialization: LazyVector cannot resolve shared references");
+            BinaryReader buf(data, len, mode_);
+            if(indexed) {
+                ChunkIndex index = ReadChunkIndex(buf);
+                base = index.base;
+                payload = index.payload;
+                count = index.count;
+                every = index.every;
+                offsets = std::move(index.offsets);
+                return;
+            }
+            unsigned int size;
+            buf.get_length(size);
+            count = size;
+            base = buf.peek(0);
+            stride = binSerialization::RecordStride<T>(mode_);
+            if(stride) {
+                buf.require_items(count, stride);
+                payload = count * stride;
+                return;
+            }
+            every = 1;
+            offsets.reserve(std::min(count, buf.remaining()));
+            for(size_t i = 0; i < count; i++) {
+                offsets.push_back(buf.position() - (base - data));
+                SkipOver<T>(buf);
+            }
+            payload = buf.position() - (base - data);
+        }
+      public:
+        class const_iterator
+        {
+          private:
+            const LazyVector *owner;
+            size_t pos;
+          public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef T value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const T* pointer;
+            typedef T reference;       // elements are decoded by value
+
+            const_iterator(const LazyVector *view = nullptr, size_t at = 0) : owner(view), pos(at) {}
+            T operator*() const { return (*owner)[pos]; }
+            T operator[](difference_type n) const { return (*owner)[pos + n]; }
+            const_iterator& operator++() { ++pos; return *this; }
+            const_iterator operator++(int) { const_iterator old = *this; ++pos; return old; }
+            const_iterator& operator--() { --pos; return *this; }
+            const_iterator operator--(int) { const_iterator old = *this; --pos; return old; }
+            const_iterator& operator+=(difference_type n) { pos += n; return *this; }
+            const_iterator& operator-=(difference_type n) { pos -= n; return *this; }
+            const_iterator operator+(difference_type n) const { return const_iterator(owner, pos + n); }
+            const_iterator operator-(difference_type n) const { return const_iterator(owner, pos - n); }
+            difference_type operator-(const const_iterator &other) const { return pos - other.pos; }
+            bool operator==(const const_iterator &other) const { return pos == other.pos; }
+            bool operator!=(const const_iterator &other) const { return pos != other.pos; }
+            bool operator<(const const_iterator &other) const { return pos < other.pos; }
+            bool operator>(const const_iterator &other) const { return pos > other.pos; }
+            bool operator<=(const const_iterator &other) const { return pos <= other.pos; }
+            bool operator>=(const const_iterator &other) const { return pos >= other.pos; }
+            friend const_iterator operator+(difference_type n, const const_iterator &it) { return it + n; }
+        };
+
+        /* over an encoded buffer; indexed for the output of SerializeIndexed */
+        LazyVector(const char *data, size_t len, Mode mode = Mode::Default, bool indexed = false)
+            : base(nullptr), payload(0), count(0), stride(0), every(0), mode_(mode) {
+            Open(data, len, indexed);
+        }
+        /* over a file, mapped for the lifetime of the view */
+        explicit LazyVector(const string &path, Mode mode = Mode::Default, bool indexed = false)
+            : file(new MappedFile(path)), base(nullptr), payload(0), count(0), stride(0), every(0), mode_(mode) {
+            Open(file->data(), file->size(), indexed);
+        }
+
+        size_t size() const {
+            return count;
+        }
+        bool empty() const {
+            return count == 0;
+        }
+        /* decodes element i; only the bytes up to it within its chunk are touched */
+        T operator[](size_t i) const {
+            size_t from, skip = 0;
+            if(stride) {
+                from = i * stride;
+            } else {
+                from = offsets[i / every];
+                skip = i % every;
+            }
+            BinaryReader buf(base + from, payload - from, mode_);
+            SkipElements<T>(skip, buf, binSerialization::FixedSize<T>());
+            T item;
+            DeserializeTo(item, buf);
+            return item;
+        }
+        T at(size_t i) const {
+            if(i >= count)
+                throw std::out_of_range("binDeserialization: LazyVector index out of range");
+            return (*this)[i];
+        }
+        const_iterator begin() const {
+            return const_iterator(this, 0);
+        }
+        const_iterator end() const {
+            return const_iterator(this, count);
+        }
+    };
+}  // namespace binDeserialization
+
+#endif
@@ -1,7 +1,65 @@
 #ifndef __OBJECT_SERIALIZATION_H__
 #define __OBJECT_SERIALIZATION_H__
 
+#include <string>
+#include <tuple>
+#include <type_traits>
+
 #define ARITHMETIC_TYPE typename std::enable_if<std::is_arithmetic<T>::value>::type
-#define STRING_TYPE typename std::enable_if<std::is_same<T, std::string>::value>::type
+#define STRING_TYPE typename std::enable_if<binSerialization::IsString<T>::value>::type
+#define FIELDS_TYPE typename std::enable_if<binSerialization::Fields<T>::value>::type
+
+namespace binSerialization {
+    /* std::string, or a char string with its own allocator */
+    template <typename T>
+    struct IsString : std::false_type {};
+    template <typename Traits, typename Alloc>
+    struct IsString<std::basic_string<char, Traits, Alloc>> : std::true_type {};
+    /* member list of a user defined type, specialised by SERIALIZE_FIELDS */
+    template <typename T, typename Enable = void>
+    struct Fields : std::false_type {};
+}  // namespace binSerialization
+
+/* SERIALIZE_FIELDS(Type, field...) at global scope, after the struct, makes
+   Type usable wherever a std type is: ser/des, containers, XML. Up to 16
+   fields; Type must be a plain (non-template) name. */
+#define SER_EXPAND(x) x
+#define SER_CAT_(a, b) a##b
+#define SER_CAT(a, b) SER_CAT_(a, b)
+#define SER_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define SER_NARG(...) SER_EXPAND(SER_NARG_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define SER_FE_1(M, T, x) M(T, x)
+#define SER_FE_2(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_1(M, T, __VA_ARGS__))
+#define SER_FE_3(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_2(M, T, __VA_ARGS__))
+#define SER_FE_4(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_3(M, T, __VA_ARGS__))
+#define SER_FE_5(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_4(M, T, __VA_ARGS__))
+#define SER_FE_6(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_5(M, T, __VA_ARGS__))
+#define SER_FE_7(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_6(M, T, __VA_ARGS__))
+#define SER_FE_8(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_7(M, T, __VA_ARGS__))
+#define SER_FE_9(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_8(M, T, __VA_ARGS__))
+#define SER_FE_10(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_9(M, T, __VA_ARGS__))
+#define SER_FE_11(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_10(M, T, __VA_ARGS__))
+#define SER_FE_12(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_11(M, T, __VA_ARGS__))
+#define SER_FE_13(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_12(M, T, __VA_ARGS__))
+#define SER_FE_14(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_13(M, T, __VA_ARGS__))
+#define SER_FE_15(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_14(M, T, __VA_ARGS__))
+#define SER_FE_16(M, T, x, ...) M(T, x), SER_EXPAND(SER_FE_15(M, T, __VA_ARGS__))
+#define SER_FOR_EACH(M, T, ...) SER_EXPAND(SER_CAT(SER_FE_, SER_NARG(__VA_ARGS__))(M, T, __VA_ARGS__))
+#define SER_MEMBER(T, field) &T::field
+#define SER_NAME(T, field) #field
+
+#define SERIALIZE_FIELDS(Type, ...)                                                          \
+    namespace binSerialization {                                                             \
+        template <>                                                                          \
+        struct Fields<Type> : std::true_type {                                               \
+            static constexpr auto members() {                                                \
+                return std::make_tuple(SER_FOR_EACH(SER_MEMBER, Type, __VA_ARGS__));         \
+            }                                                                                \
+            static const char* const* names() {                                              \
+                static const char *const list[] = {SER_FOR_EACH(SER_NAME, Type, __VA_ARGS__)}; \
+                return list;                                                                 \
+            }                                                                                \
+        };                                                                                   \
+    }
 
-#endif
\ No newline at end of file
+#endif
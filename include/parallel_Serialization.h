@@ -0,0 +1,283 @@
+#ifndef __parallel_Serialization_HEADER__
+#define __parallel_Serialization_HEADER__
+
+#include "serialize.h"
+#include <cerrno>
+#include <exception>
+#include <thread>
+
+#include <sys/file.h>
+
+namespace binSerialization {
+    inline unsigned DefaultThreads() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+    /* boundaries of at most parts contiguous ranges covering [0, n) */
+    inline std::vector<size_t> SplitRanges(size_t n, unsigned parts) {
+        std::vector<size_t> bounds(parts + 1);
+        for(unsigned k = 0; k <= parts; k++)
+            bounds[k] = n * k / parts;
+        return bounds;
+    }
+    /* runs body(k) for every k < parts on its own thread, rethrowing the first failure */
+    template <typename F>
+    void ParallelFor(unsigned parts, F body) {
+        std::vector<std::exception_ptr> errors(parts);
+        std::vector<std::thread> workers;
+        for(unsigned k = 1; k < parts; k++)
+            workers.emplace_back([&body, &errors, k] {
+                try {
+                    body(k);
+                } catch(...) {
+                    errors[k] = std::current_exception();
+                }
+            });
+        try {
+            body(0);
+        } catch(...) {
+            errors[0] = std::current_exception();
+        }
+        for(auto& worker : workers)
+            worker.join();
+        for(auto& error : errors)
+            if(error)
+                std::rethrow_exception(error);
+    }
+
+    /* vector, encoded range by range on worker threads and concatenated in
+       order; the output is byte-identical to SerializeFrom */
+    template <typename T>
+    void SerializeParallel(const std::vector<T> &obj, BinaryWriter &buf, unsigned threads = 0) {
+        if(!threads)
+            threads = DefaultThreads();
+        /* block-copied payloads are bandwidth bound already; shared references
+           need a single identity table */
+        if(threads < 2 || obj.size() < 2 * threads || buf.raw<T>() || buf.tracks_shared()) {
+            SerializeFrom(obj, buf);
+            return;
+        }
+        std::vector<size_t> bounds = SplitRanges(obj.size(), threads);
+        std::vector<std::unique_ptr<BinaryWriter>> parts(threads);
+        ParallelFor(threads, [&](unsigned k) {
+            parts[k].reset(new BinaryWriter(0, buf.mode()));
+            for(size_t i = bounds[k]; i < bounds[k + 1]; i++)
+                SerializeFrom(obj[i], *parts[k]);
+        });
+        unsigned int size = obj.size();
+        buf.put_length(size);
+        for(auto& part : parts)
+            buf.write(part->data(), part->size());
+    }
+    /* elements per chunk in an indexed vector */
+    constexpr size_t kIndexEvery = 4096;
+
+    /* indexed vector: length, payload bytes (u64), elements, then a chunk
+       index of every (u32), chunk count (u32) and one u64 payload offset per
+       chunk, so chunks can be located without decoding what precedes them */
+    template <typename T>
+    void SerializeIndexed(const std::vector<T> &obj, BinaryWriter &buf, size_t every = kIndexEvery) {
+        /* chunks must decode on their own, which back-references would break */
+        if(buf.tracks_shared())
+            throw std::logic_error("binSerialization: indexed vectors cannot use Mode::TrackShared");
+        if(!every)
+            every = kIndexEvery;
+        unsigned int size = obj.size();
+        buf.put_length(size);
+        uint64_t payload = ElementsSize(obj.begin(), obj.end(), buf.mode(), FixedSize<T>());
+        buf.put(payload);
+        std::vector<uint64_t> offsets;
+        offsets.reserve(obj.size() / every + 1);
+        size_t start = buf.position();
+        for(size_t i = 0; i < obj.size(); i++) {
+            if(i % every == 0)
+                offsets.push_back(buf.position() - start);
+            SerializeFrom(obj[i], buf);
+        }
+        /* readers trust the payload size to find the index */
+        if(buf.position() - start != payload)
+            throw std::logic_error("binSerialization: indexed payload differs from its computed size");
+        buf.put(static_cast<uint32_t>(every));
+        buf.put(static_cast<uint32_t>(offsets.size()));
+        buf.write_array(offsets.data(), offsets.size());
+    }
+}  // namespace binSerialization
+
+namespace binDeserialization {
+    /* chunk index that follows an indexed vector's payload */
+    struct ChunkIndex {
+        size_t count;
+        size_t every;
+        uint64_t payload;
+        std::vector<uint64_t> offsets;
+        const char *base;            // payload start, null for streaming readers
+    };
+    /* reads the header, steps over the payload and reads the index */
+    inline ChunkIndex ReadChunkIndex(BinaryReader &buf) {
+        ChunkIndex index;
+        unsigned int size;
+        buf.get_length(size);
+        index.count = size;
+        buf.get(index.payload);
+        /* every element takes at least one byte of the payload */
+        if(index.count > index.payload)
+            throw std::out_of_range("binDeserialization: malformed chunk index");
+        index.base = buf.streaming() ? nullptr : buf.peek(index.payload);
+        buf.skip(index.payload);
+        uint32_t every, chunks;
+        buf.get(every);
+        buf.get(chunks);
+        if(!every || chunks != (index.count + every - 1) / every)
+            throw std::out_of_range("binDeserialization: malformed chunk index");
+        index.every = every;
+        index.offsets.resize(chunks);
+        buf.read_array(index.offsets.data(), chunks);
+        /* chunks start at 0 and follow each other within the payload */
+        uint64_t last = 0;
+        for(uint64_t off : index.offsets) {
+            if(off < last || off > index.payload)
+                throw std::out_of_range("binDeserialization: malformed chunk index");
+            last = off;
+        }
+        if(chunks && index.offsets[0] != 0)
+            throw std::out_of_range("binDeserialization: malformed chunk index");
+        return index;
+    }
+    /* indexed vector, decoded in order */
+    template <typename T>
+    void DeserializeIndexed(std::vector<T> &obj, BinaryReader &buf) {
+        unsigned int size;
+        uint64_t payload;
+        buf.get_length(size);
+        buf.get(payload);
+        obj.clear();
+        DeserializeVector(obj, size, buf, IsBulkType<T>());
+        uint32_t every, chunks;
+        buf.get(every);
+        buf.get(chunks);
+        buf.skip(chunks * sizeof(uint64_t));
+    }
+    /* indexed vector, chunks decoded concurrently into preallocated slots;
+       streaming readers fall back to DeserializeIndexed */
+    template <typename T>
+    void DeserializeParallel(std::vector<T> &obj, BinaryReader &buf, unsigned threads = 0) {
+        /* chunks decode on their own, so they cannot resolve back-references */
+        if(buf.tracks_shared())
+            throw std::logic_error("binDeserialization: indexed vectors cannot use Mode::TrackShared");
+        if(buf.streaming()) {
+            DeserializeIndexed(obj, buf);
+            return;
+        }
+        if(!threads)
+            threads = binSerialization::DefaultThreads();
+        ChunkIndex index = ReadChunkIndex(buf);
+        size_t chunks = index.offsets.size();
+        if(threads > chunks)
+            threads = chunks ? chunks : 1;
+        obj.clear();
+        obj.resize(index.count);
+        std::vector<size_t> groups = binSerialization::SplitRanges(chunks, threads);
+        Mode mode = buf.mode();
+        binSerialization::ParallelFor(threads, [&](unsigned k) {
+            size_t first = groups[k], last = groups[k + 1];
+            if(first == last)
+                return;
+            uint64_t from = index.offsets[first];
+            uint64_t to = last < chunks ? index.offsets[last] : index.payload;
+            BinaryReader part(index.base + from, to - from, mode);
+            size_t end = std::min(last * index.every, index.count);
+            for(size_t i = first * index.every; i < end; i++)
+                DeserializeTo(obj[i], part);
+            if(part.remaining())
+                throw std::out_of_range("binDeserialization: chunk does not end at the next offset");
+        });
+    }
+}  // namespace binDeserialization
+
+namespace ser {
+    /* vector, appended to path by worker threads that each pwrite their own
+       range at an offset precomputed with ElementsSize. The end of the file is
+       read and written under an exclusive flock, so concurrent calls append
+       one after another; writers that do not take the lock, such as FileSink,
+       must not append to the same file meanwhile. On failure, including a
+       range whose encoding differs from its computed size, the file is cut
+       back to its previous size. */
+    template <typename T>
+    void serialize_parallel(const std::vector<T> &obj, const string &path, unsigned threads = 0,
+                            binSerialization::Mode mode = binSerialization::Mode::Default) {
+        if(!threads)
+            threads = binSerialization::DefaultThreads();
+        if(threads < 2 || obj.size() < 2 * threads || binSerialization::HasMode(mode, binSerialization::Mode::TrackShared)) {
+            serialize(obj, path, mode);
+            return;
+        }
+        std::vector<size_t> bounds = binSerialization::SplitRanges(obj.size(), threads);
+        std::vector<size_t> sizes(threads);
+        binSerialization::ParallelFor(threads, [&](unsigned k) {
+            sizes[k] = binSerialization::ElementsSize(obj.begin() + bounds[k], obj.begin() + bounds[k + 1], mode,
+                                                      binSerialization::FixedSize<T>());
+        });
+
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if(fd < 0)
+            throw std::runtime_error("binSerialization: cannot open " + path);
+        int locked;
+        while((locked = ::flock(fd, LOCK_EX)) < 0 && errno == EINTR) {}
+        if(locked < 0) {
+            ::close(fd);
+            throw std::runtime_error("binSerialization: cannot lock " + path);
+        }
+        off_t base = ::lseek(fd, 0, SEEK_END);
+        try {
+            if(base < 0)
+                throw std::runtime_error("binSerialization: cannot seek " + path);
+            binSerialization::BinaryWriter header(0, mode);
+            unsigned int size = obj.size();
+            header.put_length(size);
+            binSerialization::OffsetSink(fd, base).Consume(header.data(), header.size());
+            std::vector<off_t> offsets(threads);
+            offsets[0] = base + header.size();
+            for(unsigned k = 1; k < threads; k++)
+                offsets[k] = offsets[k - 1] + sizes[k - 1];
+            binSerialization::ParallelFor(threads, [&](unsigned k) {
+                binSerialization::OffsetSink sink(fd, offsets[k]);
+                binSerialization::BinaryWriter buf(sink, std::min(std::max<size_t>(sizes[k], 1), binSerialization::kChunkSize), mode);
+                for(size_t i = bounds[k]; i < bounds[k + 1]; i++)
+                    binSerialization::SerializeFrom(obj[i], buf);
+                buf.flush();
+                /* a range of another size overlaps or leaves a gap */
+                if(buf.position() != sizes[k])
+                    throw std::logic_error("binSerialization: encoded range differs from its computed size");
+            });
+        } catch(...) {
+            bool restored = base >= 0 && ::ftruncate(fd, base) == 0;
+            ::close(fd);
+            if(base >= 0 && !restored)
+                throw std::runtime_error("binSerialization: cannot cut " + path + " back after a failed append");
+            throw;
+        }
+        ::close(fd);             // releases the lock
+    }
+    /* vector with a chunk index, readable by des::deserialize_parallel */
+    template <typename T>
+    void serialize_indexed(const std::vector<T> &obj, const string &path, size_t every = binSerialization::kIndexEvery,
+                           binSerialization::Mode mode = binSerialization::Mode::Default) {
+        binSerialization::FileSink file(path);
+        binSerialization::BinaryWriter buf(file, binSerialization::kChunkSize, mode);
+        binSerialization::SerializeIndexed(obj, buf, every);
+        buf.flush();
+    }
+}  // namespace ser
+
+namespace des {
+    /* indexed vector, decoded by several threads over the mapped file */
+    template <typename T>
+    void deserialize_parallel(std::vector<T> &obj, const string &path, unsigned threads = 0,
+                              binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        binDeserialization::MappedFile file(path);
+        binDeserialization::BinaryReader buf(file.data(), file.size(), mode);
+        binDeserialization::DeserializeParallel(obj, buf, threads);
+    }
+}  // namespace des
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef __record_Serialization_HEADER__
+#define __record_Serialization_HEADER__
+
+#include "serialize.h"
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace binSerialization {
+    /* framed record log: each record is a fixed header and its payload
+           magic   u32  kRecordMagic
+           type    u32  caller's tag, kIndexRecord is reserved
+           length  u64  payload bytes
+       An index record holds the offsets of the data records before it, their
+       count, its own offset and kIndexMagic; a file ending in one is opened
+       without a scan. Headers and index are never compact. */
+    constexpr uint32_t kRecordMagic = 0x3152534f;  // "OSR1"
+    constexpr uint32_t kIndexMagic = 0x5852534f;   // "OSRX"
+    constexpr uint32_t kIndexRecord = 0xffffffff;
+    constexpr size_t kRecordHeader = 16;
+}  // namespace binSerialization
+
+namespace binDeserialization {
+    using binSerialization::kRecordMagic;
+    using binSerialization::kIndexMagic;
+    using binSerialization::kIndexRecord;
+    using binSerialization::kRecordHeader;
+
+    /* walks the records of a log file; payloads are decoded only on Read() */
+    class RecordReader
+    {
+      private:
+        MappedFile file;
+        Mode mode_;
+        size_t next;                 // header of the record after the current one
+        size_t cur;                  // header of the current record
+        bool valid;
+        uint32_t type_;
+        size_t length;
+        std::vector<uint64_t> offsets;
+        bool indexed;
+
+        /* false unless a whole record starts at at */
+        bool Framed(size_t at, uint32_t &type, uint64_t &len) const {
+            if(at > file.size() || file.size() - at < kRecordHeader)
+                return false;
+            BinaryReader head(file.data() + at, kRecordHeader);
+            uint32_t magic;
+            head.get(magic);
+            head.get(type);
+            head.get(len);
+            return magic == kRecordMagic && len <= file.size() - at - kRecordHeader;
+        }
+        /* false at the end of the file */
+        bool Header(size_t at, uint32_t &type, uint64_t &len) const {
+            if(at == file.size())
+                return false;
+            if(!Framed(at, type, len))
+                throw std::out_of_range("binDeserialization: truncated or malformed record");
+            return true;
+        }
+        /* the index record at the end of the file, if the last writer left one */
+        bool Footer() {
+            size_t end = file.size();
+            if(end < kRecordHeader + 20)
+                return false;
+            BinaryReader tail(file.data() + end - 12, 12);
+            uint64_t at;
+            uint32_t magic;
+            tail.get(at);
+            tail.get(magic);
+            if(magic != kIndexMagic || at > end - kRecordHeader - 20)
+                return false;
+            BinaryReader head(file.data() + at, end - at);
+            uint32_t type;
+            uint64_t len, count;
+            head.get(magic);
+            head.get(type);
+            head.get(len);
+            if(magic != kRecordMagic || type != kIndexRecord || len != end - at - kRecordHeader || (len - 20) % 8)
+                return false;
+            count = (len - 20) / 8;
+            std::vector<uint64_t> found(count);
+            head.read_array(found.data(), count);
+            uint64_t stored;
+            head.get(stored);
+            if(stored != count)
+                return false;
+            /* data records lie before the index, in order */
+            for(size_t i = 0; i < count; i++)
+                if(found[i] + kRecordHeader > at || (i && found[i] <= found[i - 1]))
+                    return false;
+            offsets = std::move(found);
+            return true;
+        }
+        void Index() {
+            if(indexed)
+                return;
+            if(!Footer()) {
+                uint32_t type;
+                uint64_t len;
+                for(size_t at = 0; Header(at, type, len); at += kRecordHeader + len)
+                    if(type != kIndexRecord)
+                        offsets.push_back(at);
+            }
+            indexed = true;
+        }
+      public:
+        explicit RecordReader(const string &path, Mode mode = Mode::Default)
+            : file(path), mode_(mode), next(0), cur(0), valid(false), type_(0), length(0), indexed(false) {}
+
+        /* moves to the next data record; the payload of the current one is
+           skipped unread. False after the last record. */
+        bool Next() {
+            uint32_t type;
+            uint64_t len;
+            while(Header(next, type, len)) {
+                size_t at = next;
+                next += kRecordHeader + len;
+                if(type != kIndexRecord) {
+                    cur = at;
+                    type_ = type;
+                    length = len;
+                    return valid = true;
+                }
+            }
+            return valid = false;
+        }
+        /* makes record n current; Next() continues after it */
+        void Seek(size_t n) {
+            Index();
+            if(n >= offsets.size())
+                throw std::out_of_range("binDeserialization: record index out of range");
+            next = offsets[n];
+            Next();
+        }
+        /* end of the last whole record, indexing the data records up to it;
+           less than the file size when a crash left a torn record behind */
+        size_t Recover() {
+            offsets.clear();
+            indexed = true;
+            if(Footer())
+                return file.size();
+            uint32_t type;
+            uint64_t len;
+            size_t at = 0;
+            for(; Framed(at, type, len); at += kRecordHeader + len)
+                if(type != kIndexRecord)
+                    offsets.push_back(at);
+            return at;
+        }
+        /* data records in the file: from the footer, or from one pass over the headers */
+        size_t count() {
+            Index();
+            return offsets.size();
+        }
+        const std::vector<uint64_t>& index() {
+            Index();
+            return offsets;
+        }
+        uint32_t type() const {
+            return type_;
+        }
+        /* payload of the current record */
+        const char* data() const {
+            return file.data() + cur + kRecordHeader;
+        }
+        size_t size() const {
+            return length;
+        }
+        template <typename T>
+        void Read(T &obj) const {
+            if(!valid)
+                throw std::logic_error("binDeserialization: no current record");
+            BinaryReader buf(data(), length, mode_);
+            DeserializeTo(obj, buf);
+        }
+    };
+}  // namespace binDeserialization
+
+namespace binSerialization {
+    /* appends framed records to a log file, one write per record. A single
+       writer at a time: offsets are counted from the size at open. A torn
+       record left by a crash is cut off before appending. */
+    class RecordWriter
+    {
+      private:
+        FileSink file;
+        BinaryWriter buf;
+        uint64_t end;                // offset of the next record
+        bool indexed;
+        bool closed;
+        std::vector<uint64_t> offsets;
+
+        void Emit(uint32_t type) {
+            uint64_t len = buf.size() - kRecordHeader;
+            char *head = buf.data();
+            std::memcpy(head, &kRecordMagic, 4);
+            std::memcpy(head + 4, &type, 4);
+            std::memcpy(head + 8, &len, 8);
+            file.Consume(buf.data(), buf.size());
+            if(type != kIndexRecord)
+                offsets.push_back(end);
+            end += buf.size();
+        }
+      public:
+        /* with indexed, Close() ends the file with an index of all its data
+           records, including those of earlier writers */
+        explicit RecordWriter(const string &path, Mode mode = Mode::Default, bool index = true)
+            : file(path), buf(0, mode), end(0), indexed(index), closed(false) {
+            struct stat st;
+            if(::stat(path.c_str(), &st) == 0)
+                end = st.st_size;
+            if(!end)
+                return;
+            uint64_t intact;
+            {
+                binDeserialization::RecordReader log(path);
+                intact = log.Recover();
+                if(indexed)
+                    offsets = log.index();
+            }
+            if(intact < end) {
+                if(::truncate(path.c_str(), intact) < 0)
+                    throw std::runtime_error("binSerialization: cannot cut the torn record off " + path);
+                end = intact;
+            }
+        }
+        RecordWriter(const RecordWriter&) = delete;
+        RecordWriter& operator=(const RecordWriter&) = delete;
+        ~RecordWriter() {
+            try {
+                Close();
+            } catch(...) {}
+        }
+
+        template <typename T>
+        void Append(const T &obj, uint32_t type = 0) {
+            if(closed)
+                throw std::logic_error("binSerialization: record log already closed");
+            if(type == kIndexRecord)
+                throw std::logic_error("binSerialization: record type reserved for the index");
+            buf.clear();
+            buf.claim(kRecordHeader);
+            SerializeFrom(obj, buf);
+            Emit(type);
+        }
+        void Close() {
+            if(closed)
+                return;
+            closed = true;
+            if(!indexed)
+                return;
+            uint64_t at = end, count = offsets.size();
+            buf.clear();
+            buf.claim(kRecordHeader);
+            buf.write_array(offsets.data(), offsets.size());
+            buf.put(count);
+            buf.put(at);
+            buf.put(kIndexMagic);
+            Emit(kIndexRecord);
+        }
+    };
+}  // namespace binSerialization
+
+#endif
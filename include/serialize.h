@@ -2,32 +2,41 @@
 #define __SERIALIZE_HEADER__
 
 #include "bin_Serialization.h"
+#include "bin_Arena.h"
+#include "bin_File.h"
 #include "xml_Serialization.h"
 
 namespace ser {
-    /* binary normal type */
+    /* binary normal type, appended through a kChunkSize window. The file is
+       opened once the first window fills, so an exception from an object that
+       encodes to less than that leaves it untouched; a larger one may leave a
+       partial archive at the end of the file. */
     template <typename T>
-    void serialize(const T &obj, const string &path) {
-        stringstream buf;
+    void serialize(const T &obj, const string &path, binSerialization::Mode mode = binSerialization::Mode::Default) {
+        binSerialization::DeferredFileSink file(path);
+        binSerialization::BinaryWriter buf(file, binSerialization::kChunkSize, mode);
         binSerialization::SerializeFrom(obj, buf);
-        ofstream FILE(path, ios::app | ios::binary);
-        FILE << buf.str();
-        FILE.close();
+        buf.flush();
+        file.Open();
     }
     /* For pointers */
     template <typename T>
-    void serialize(const T &obj, const string &path, size_t size) {
-        stringstream buf;
+    void serialize(const T &obj, const string &path, size_t size, binSerialization::Mode mode = binSerialization::Mode::Default) {
+        binSerialization::DeferredFileSink file(path);
+        binSerialization::BinaryWriter buf(file, binSerialization::kChunkSize, mode);
         binSerialization::SerializeFrom(obj, buf, size);
-        ofstream FILE(path, ios::app | ios::binary);
-        FILE << buf.str();
-        FILE.close();
+        buf.flush();
+        file.Open();
     }
-    /* binary user defined type */
+    /* binary user defined type: all fields share one buffer and one open/write */
     template <typename ...Args>
     void user_serialize(const string &path, const Args&...args) {
-        int arr[] = {(serialize(args, path), 0)...};
+        binSerialization::DeferredFileSink file(path);
+        binSerialization::BinaryWriter buf(file, binSerialization::kChunkSize);
+        int arr[] = {(binSerialization::SerializeFrom(args, buf), 0)...};
         arr[0] = arr[1];
+        buf.flush();
+        file.Open();
     }
     
     /* xml normal type */
@@ -42,10 +51,11 @@ namespace ser {
         xmlSerialization::xmlSerialization ser_xml(path.c_str());
         ser_xml.SerializeFrom(obj, type_name, ser_xml.GetXmlRoot(), size);
     }
-    /* xml user defined types */
+    /* xml user defined types: one document load and save for all fields */
     template <typename ...Args>
     void user_serialize_xml(const string &type_name, const string &path, const Args&... args) {
-        int arr[] = {(serialize_xml(args, type_name, path), 0)...};
+        xmlSerialization::xmlSerialization ser_xml(path.c_str());
+        int arr[] = {(ser_xml.SerializeFrom(args, type_name, ser_xml.GetXmlRoot()), 0)...};
         arr[0] = arr[1];
     }
 }  // namespace ser
@@ -53,33 +63,55 @@ namespace ser {
 namespace des {
     /* binary normal type */
     template <typename T>
-    void deserialize(T &obj, const string &path) {
-        stringstream buf;
-        ifstream FILE(path, ios::out | ios::binary);
-        buf << FILE.rdbuf();
-        FILE.close();
+    void deserialize(T &obj, const string &path, binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        binDeserialization::MappedFile file(path);
+        binDeserialization::BinaryReader buf(file.data(), file.size(), mode);
         binDeserialization::DeserializeTo(obj, buf);
     }
     /* For pointers */
     template <typename T>
-    void deserialize(T &obj, const string &path, size_t size) {
-        stringstream buf;
-        ifstream FILE(path, ios::out | ios::binary);
-        buf << FILE.rdbuf();
-        FILE.close();
+    void deserialize(T &obj, const string &path, size_t size, binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        binDeserialization::MappedFile file(path);
+        binDeserialization::BinaryReader buf(file.data(), file.size(), mode);
         binDeserialization::DeserializeTo(obj, buf);
     }
+    /* pointer array into a caller-owned buffer of capacity elements, nothing
+       allocated; returns the number of elements decoded */
+    template <typename T>
+    size_t deserialize_into(T *obj, size_t capacity, const string &path, binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        binDeserialization::MappedFile file(path);
+        binDeserialization::BinaryReader buf(file.data(), file.size(), mode);
+        return binDeserialization::DeserializeInto(obj, capacity, buf);
+    }
+    /* binary, decoded while the file is read through a fixed window */
+    template <typename T>
+    void deserialize_stream(T &obj, const string &path, binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        binDeserialization::FileSource file(path);
+        binDeserialization::BinaryReader buf(file, binSerialization::kChunkSize, mode);
+        binDeserialization::DeserializeTo(obj, buf);
+    }
+    /* binary from a caller-owned buffer, no copy */
+    template <typename T>
+    size_t deserialize_buffer(T &obj, const char *data, size_t len, binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        binDeserialization::BinaryReader buf(data, len, mode);
+        binDeserialization::DeserializeTo(obj, buf);
+        return buf.position();
+    }
+    /* binary, with StringView fields left pointing into the mapped file,
+       e.g. deserialize_view<map<StringView, int>>(path) */
+    template <typename T>
+    binDeserialization::MappedView<T> deserialize_view(const string &path, binDeserialization::Mode mode = binDeserialization::Mode::Default) {
+        return binDeserialization::MappedView<T>(path, mode);
+    }
     /* binary user defined type */
     template <typename T>
-    void deserializer(T &obj, stringstream &buf) {
+    void deserializer(T &obj, binDeserialization::BinaryReader &buf) {
         binDeserialization::DeserializeTo(obj, buf);
     }
     template <typename ...Args>
     void user_deserialize(const string &path, Args&...args) {
-        stringstream buf;
-        ifstream FILE(path, ios::out | ios::binary);
-        buf << FILE.rdbuf();
-        FILE.close();
+        binDeserialization::MappedFile file(path);
+        binDeserialization::BinaryReader buf(file.data(), file.size());
         int arr[] = {(deserializer(args, buf), 0)...};
         arr[0] = arr[1];
     }
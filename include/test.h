@@ -1,7 +1,10 @@
 #ifndef __TEST_HEADER__
 #define __TEST_HEADER__
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
+#include "macro.h"
 
 struct UserDefinedType {
     int idx;
@@ -14,6 +17,30 @@ struct UserDefinedType {
         std::cout << std::endl;
     }
 };
+SERIALIZE_FIELDS(UserDefinedType, idx, name, data)
+
+/* all arithmetic, no padding: encoded as one block */
+struct Sample {
+    int id;
+    float weight;
+    double value;
+};
+SERIALIZE_FIELDS(Sample, id, weight, value)
+
+/* listed out of memory order: encoded field by field in list order */
+struct Swapped {
+    int first;
+    float second;
+};
+SERIALIZE_FIELDS(Swapped, second, first)
+
+/* tree with back edges, only serializable with Mode::TrackShared */
+struct Node {
+    std::string label;
+    std::vector<std::shared_ptr<Node>> children;
+    std::weak_ptr<Node> parent;
+};
+SERIALIZE_FIELDS(Node, label, children, parent)
 
 std::int32_t ERROR = 0;
 std::int32_t error = 0;
@@ -26,6 +53,27 @@ void bin_map_test();
 void bin_ptr_test();
 void bin_nested_test();
 void bin_user_test();
+void bin_buffer_test();
+void bin_bulk_test();
+void bin_size_test();
+void bin_compact_test();
+void bin_stream_test();
+void bin_refill_test();
+void bin_async_test();
+void bin_batch_file_test();
+void bin_parallel_test();
+void bin_chunk_index_test();
+void bin_batch_serializer_test();
+void bin_lazy_test();
+void bin_view_test();
+void bin_columnar_test();
+void bin_fields_test();
+void bin_fixed_layout_test();
+void bin_shared_test();
+void bin_reuse_test();
+void bin_array_ptr_test();
+void bin_arena_test();
+void bin_record_test();
 void xml_arithmetic_test();
 void xml_string_test();
 void xml_vector_test();
@@ -35,6 +83,8 @@ void xml_map_test();
 void xml_ptr_test();
 void xml_nested_test();
 void xml_user_test();
+void xml_fields_test();
+void xml_fixed_layout_test();
 void bin_serialization_test();
 void xml_serialization_test();
 
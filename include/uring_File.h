@@ -0,0 +1,495 @@
+#ifndef __uring_File_HEADER__
+#define __uring_File_HEADER__
+
+#include "bin_Serialization.h"
+#include "bin_File.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BIN_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace binSerialization {
+    /* one request for IoUring::Run */
+    struct UringOp {
+        uint8_t opcode;
+        int fd;
+        uint64_t addr;
+        uint32_t len;
+        uint64_t off;
+        uint32_t open_flags;
+        bool link;       // the next op only runs if this one fully succeeds
+    };
+
+    /* minimal io_uring driver over the raw syscalls; Ready() is false when
+       the kernel, a seccomp filter or the build lacks open/read/write/close */
+    class IoUring
+    {
+#ifdef BIN_HAVE_IO_URING
+      private:
+        int ring_fd;
+        unsigned entries;
+        void *sq_ptr;
+        size_t sq_len;
+        void *cq_ptr;
+        size_t cq_len;
+        io_uring_sqe *sqes;
+        size_t sqes_len;
+        unsigned *sq_tail;
+        unsigned *sq_mask;
+        unsigned *sq_array;
+        unsigned *cq_head;
+        unsigned *cq_tail;
+        unsigned *cq_mask;
+        io_uring_cqe *cqes;
+        bool statx_op;
+
+        bool Probe() {
+            const size_t len = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+            std::vector<char> storage(len, 0);
+            io_uring_probe *probe = reinterpret_cast<io_uring_probe*>(storage.data());
+            if(::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+                return false;
+            const uint8_t needed[] = {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE};
+            for(uint8_t op : needed)
+                if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                    return false;
+            statx_op = IORING_OP_STATX <= probe->last_op && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED);
+            return true;
+        }
+        void Release() {
+            if(sqes)
+                ::munmap(sqes, sqes_len);
+            if(cq_ptr && cq_ptr != sq_ptr)
+                ::munmap(cq_ptr, cq_len);
+            if(sq_ptr)
+                ::munmap(sq_ptr, sq_len);
+            if(ring_fd >= 0)
+                ::close(ring_fd);
+            sqes = nullptr;
+            sq_ptr = cq_ptr = nullptr;
+            ring_fd = -1;
+        }
+        void Setup(unsigned depth) {
+            io_uring_params p;
+            std::memset(&p, 0, sizeof(p));
+            ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &p));
+            if(ring_fd < 0)
+                return;
+            if(!(p.features & IORING_FEAT_RW_CUR_POS)) {
+                Release();
+                return;
+            }
+            entries = p.sq_entries;
+            sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+            if(single && cq_len > sq_len)
+                sq_len = cq_len;
+            sq_ptr = ::mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+            if(sq_ptr == MAP_FAILED) {
+                sq_ptr = nullptr;
+                Release();
+                return;
+            }
+            cq_ptr = single ? sq_ptr : ::mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+            if(cq_ptr == MAP_FAILED) {
+                cq_ptr = nullptr;
+                Release();
+                return;
+            }
+            sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+            void *s = ::mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+            if(s == MAP_FAILED) {
+                Release();
+                return;
+            }
+            sqes = static_cast<io_uring_sqe*>(s);
+            char *sq = static_cast<char*>(sq_ptr);
+            char *cq = static_cast<char*>(cq_ptr);
+            sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+            cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+            if(!Probe())
+                Release();
+        }
+        /* queues ops [first, last) and waits for all of their completions */
+        void Submit(const std::vector<UringOp> &ops, size_t first, size_t last, std::vector<int> &res) {
+            unsigned tail = *sq_tail;
+            for(size_t i = first; i < last; i++) {
+                unsigned slot = tail & *sq_mask;
+                io_uring_sqe *sqe = &sqes[slot];
+                std::memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = ops[i].opcode;
+                sqe->fd = ops[i].fd;
+                sqe->addr = ops[i].addr;
+                sqe->len = ops[i].len;
+                sqe->off = ops[i].off;
+                sqe->open_flags = ops[i].open_flags;
+                sqe->flags = ops[i].link ? IOSQE_IO_LINK : 0;
+                sqe->user_data = i;
+                sq_array[slot] = slot;
+                tail++;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+            unsigned pending = static_cast<unsigned>(last - first);
+            unsigned to_submit = pending;
+            while(pending) {
+                long done = ::syscall(__NR_io_uring_enter, ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if(done < 0 && errno != EINTR)
+                    throw std::runtime_error("binSerialization: io_uring_enter failed");
+                if(done > 0)
+                    to_submit -= static_cast<unsigned>(done);
+                unsigned head = *cq_head;
+                unsigned ready = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                for(; head != ready; head++, pending--) {
+                    const io_uring_cqe &cqe = cqes[head & *cq_mask];
+                    res[cqe.user_data] = cqe.res;
+                }
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            }
+        }
+      public:
+        explicit IoUring(unsigned depth = 64)
+            : ring_fd(-1), entries(0), sq_ptr(nullptr), sq_len(0), cq_ptr(nullptr), cq_len(0), sqes(nullptr), sqes_len(0),
+              statx_op(false) {
+            if(depth)
+                Setup(depth);
+        }
+        ~IoUring() {
+            Release();
+        }
+        bool Ready() const {
+            return ring_fd >= 0;
+        }
+        /* whether IORING_OP_STATX can be submitted: fd is the directory, addr
+           the path, len the mask, off the struct statx and open_flags its flags */
+        bool CanStat() const {
+            return Ready() && statx_op;
+        }
+        /* runs every op and returns its result (>= 0, or -errno); linked
+           chains are never split across submissions */
+        std::vector<int> Run(const std::vector<UringOp> &ops) {
+            std::vector<int> res(ops.size(), -ECANCELED);
+            size_t first = 0;
+            while(first < ops.size()) {
+                size_t last = first, cut = first;
+                while(last < ops.size() && last - first < entries) {
+                    last++;
+                    if(!ops[last - 1].link)
+                        cut = last;
+                }
+                if(cut == first)
+                    throw std::logic_error("binSerialization: io_uring chain longer than the ring");
+                Submit(ops, first, cut, res);
+                first = cut;
+            }
+            return res;
+        }
+#else
+      public:
+        explicit IoUring(unsigned = 64) {}
+        bool Ready() const {
+            return false;
+        }
+        bool CanStat() const {
+            return false;
+        }
+        std::vector<int> Run(const std::vector<UringOp> &ops) {
+            return std::vector<int>(ops.size(), -ENOSYS);
+        }
+#endif
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+    };
+
+    /* plain-syscall helpers used when io_uring is unavailable or a
+       request comes back short */
+    inline int WriteAll(int fd, const char *data, size_t n) {
+        while(n) {
+            ssize_t done = ::write(fd, data, n);
+            if(done < 0 && errno == EINTR)
+                continue;
+            if(done < 0)
+                return -errno;
+            data += done;
+            n -= done;
+        }
+        return 0;
+    }
+    inline int PreadAll(int fd, char *data, size_t n, size_t off) {
+        while(n) {
+            ssize_t got = ::pread(fd, data, n, off);
+            if(got < 0 && errno == EINTR)
+                continue;
+            if(got < 0)
+                return -errno;
+            if(got == 0)
+                return -EIO;
+            data += got;
+            off += got;
+            n -= got;
+        }
+        return 0;
+    }
+}  // namespace binSerialization
+
+namespace ser {
+    /* encodes many objects up front, then appends each to its own file
+       with batched io_uring opens, writes and closes */
+    class BatchWriter
+    {
+      private:
+        struct Job {
+            string path;
+            std::unique_ptr<binSerialization::BinaryWriter> buf;
+        };
+        std::vector<Job> jobs;
+        binSerialization::IoUring ring;
+
+        std::vector<int> RunPlain() {
+            std::vector<int> status(jobs.size(), 0);
+            for(size_t i = 0; i < jobs.size(); i++) {
+                int fd = ::open(jobs[i].path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+                if(fd < 0) {
+                    status[i] = -errno;
+                    continue;
+                }
+                status[i] = binSerialization::WriteAll(fd, jobs[i].buf->data(), jobs[i].buf->size());
+                if(::close(fd) < 0 && !status[i])
+                    status[i] = -errno;
+            }
+            return status;
+        }
+#ifdef BIN_HAVE_IO_URING
+        std::vector<int> RunUring() {
+            std::vector<int> status(jobs.size(), 0);
+            std::vector<binSerialization::UringOp> ops;
+            for(auto& job : jobs)
+                ops.push_back({IORING_OP_OPENAT, AT_FDCWD, reinterpret_cast<uint64_t>(job.path.c_str()),
+                               0644, 0, O_WRONLY | O_CREAT | O_APPEND, false});
+            std::vector<int> fds = ring.Run(ops);
+
+            ops.clear();
+            std::vector<size_t> owner;
+            for(size_t i = 0; i < jobs.size(); i++) {
+                if(fds[i] < 0) {
+                    status[i] = fds[i];
+                    continue;
+                }
+                /* offset -1: the file position, i.e. append under O_APPEND */
+                ops.push_back({IORING_OP_WRITE, fds[i], reinterpret_cast<uint64_t>(jobs[i].buf->data()),
+                               static_cast<uint32_t>(jobs[i].buf->size()), static_cast<uint64_t>(-1), 0, true});
+                ops.push_back({IORING_OP_CLOSE, fds[i], 0, 0, 0, 0, false});
+                owner.push_back(i);
+            }
+            std::vector<int> res = ring.Run(ops);
+            for(size_t k = 0; k < owner.size(); k++) {
+                size_t i = owner[k];
+                int written = res[2 * k], closed = res[2 * k + 1];
+                if(closed == -ECANCELED) {
+                    /* short or failed write broke the chain: finish by hand */
+                    size_t done = written > 0 ? written : 0;
+                    status[i] = written < 0 ? written
+                        : binSerialization::WriteAll(fds[i], jobs[i].buf->data() + done, jobs[i].buf->size() - done);
+                    if(::close(fds[i]) < 0 && !status[i])
+                        status[i] = -errno;
+                } else {
+                    status[i] = closed;
+                }
+            }
+            return status;
+        }
+#endif
+      public:
+        explicit BatchWriter(bool use_uring = true, unsigned depth = 64) : ring(use_uring ? depth : 0) {}
+
+        /* binary normal type */
+        template <typename T>
+        void Add(const T &obj, const string &path, binSerialization::Mode mode = binSerialization::Mode::Default) {
+            Job job;
+            job.path = path;
+            job.buf.reset(new binSerialization::BinaryWriter(0, mode));
+            binSerialization::SerializeFrom(obj, *job.buf);
+            jobs.push_back(std::move(job));
+        }
+        /* For pointers */
+        template <typename T>
+        void Add(const T &obj, const string &path, size_t size, binSerialization::Mode mode = binSerialization::Mode::Default) {
+            Job job;
+            job.path = path;
+            job.buf.reset(new binSerialization::BinaryWriter(0, mode));
+            binSerialization::SerializeFrom(obj, *job.buf, size);
+            jobs.push_back(std::move(job));
+        }
+        bool UsesUring() const {
+            return ring.Ready();
+        }
+        /* writes every added object; one status per Add, 0 or -errno */
+        std::vector<int> Run() {
+            std::vector<int> status;
+            bool fits = true;
+            for(auto& job : jobs)
+                fits = fits && job.buf->size() <= 0x7ffff000u;
+#ifdef BIN_HAVE_IO_URING
+            status = ring.Ready() && fits ? RunUring() : RunPlain();
+#else
+            status = RunPlain();
+#endif
+            jobs.clear();
+            return status;
+        }
+    };
+}  // namespace ser
+
+namespace des {
+    /* reads many files with batched io_uring opens, reads and closes,
+       then decodes each into the object it was added with */
+    class BatchReader
+    {
+      private:
+        struct Job {
+            string path;
+            std::function<void(const char*, size_t)> decode;
+            string bytes;
+        };
+        std::vector<Job> jobs;
+        binSerialization::IoUring ring;
+        binDeserialization::Mode mode_;
+
+        /* size the buffer from fstat; ReadUring gets sizes from statx instead */
+        static int Prepare(int fd, Job &job) {
+            struct stat st;
+            if(::fstat(fd, &st) < 0)
+                return -errno;
+            job.bytes.resize(st.st_size);
+            return 0;
+        }
+        std::vector<int> ReadPlain() {
+            std::vector<int> status(jobs.size(), 0);
+            for(size_t i = 0; i < jobs.size(); i++) {
+                int fd = ::open(jobs[i].path.c_str(), O_RDONLY);
+                if(fd < 0) {
+                    status[i] = -errno;
+                    continue;
+                }
+                status[i] = Prepare(fd, jobs[i]);
+                if(!status[i])
+                    status[i] = binSerialization::PreadAll(fd, &jobs[i].bytes[0], jobs[i].bytes.size(), 0);
+                ::close(fd);
+            }
+            return status;
+        }
+#ifdef BIN_HAVE_IO_URING
+        std::vector<int> ReadUring() {
+            std::vector<int> status(jobs.size(), 0);
+            std::vector<binSerialization::UringOp> ops;
+            /* sizes come from statx in the same batch as the opens, so no
+               file waits on a synchronous fstat; older kernels fall back to it */
+            bool stat = ring.CanStat();
+            std::vector<struct statx> info(stat ? jobs.size() : 0);
+            for(size_t i = 0; i < jobs.size(); i++) {
+                ops.push_back({IORING_OP_OPENAT, AT_FDCWD, reinterpret_cast<uint64_t>(jobs[i].path.c_str()),
+                               0, 0, O_RDONLY, false});
+                if(stat)
+                    ops.push_back({IORING_OP_STATX, AT_FDCWD, reinterpret_cast<uint64_t>(jobs[i].path.c_str()),
+                                   STATX_SIZE, reinterpret_cast<uint64_t>(&info[i]), 0, false});
+            }
+            std::vector<int> opened = ring.Run(ops);
+            size_t per = stat ? 2 : 1;
+
+            ops.clear();
+            std::vector<int> fds(jobs.size());
+            std::vector<size_t> owner;
+            for(size_t i = 0; i < jobs.size(); i++) {
+                fds[i] = opened[per * i];
+                if(fds[i] < 0) {
+                    status[i] = fds[i];
+                    continue;
+                }
+                if(stat && opened[per * i + 1] == 0 && (info[i].stx_mask & STATX_SIZE))
+                    jobs[i].bytes.resize(info[i].stx_size);
+                else
+                    status[i] = Prepare(fds[i], jobs[i]);
+                if(status[i] || jobs[i].bytes.size() > 0x7ffff000u) {
+                    if(!status[i])
+                        status[i] = binSerialization::PreadAll(fds[i], &jobs[i].bytes[0], jobs[i].bytes.size(), 0);
+                    ::close(fds[i]);
+                    continue;
+                }
+                ops.push_back({IORING_OP_READ, fds[i], reinterpret_cast<uint64_t>(&jobs[i].bytes[0]),
+                               static_cast<uint32_t>(jobs[i].bytes.size()), 0, 0, true});
+                ops.push_back({IORING_OP_CLOSE, fds[i], 0, 0, 0, 0, false});
+                owner.push_back(i);
+            }
+            std::vector<int> res = ring.Run(ops);
+            for(size_t k = 0; k < owner.size(); k++) {
+                size_t i = owner[k];
+                int got = res[2 * k], closed = res[2 * k + 1];
+                if(closed == -ECANCELED) {
+                    size_t done = got > 0 ? got : 0;
+                    status[i] = got < 0 ? got
+                        : binSerialization::PreadAll(fds[i], &jobs[i].bytes[done], jobs[i].bytes.size() - done, done);
+                    ::close(fds[i]);
+                } else {
+                    status[i] = closed;
+                }
+            }
+            return status;
+        }
+#endif
+      public:
+        explicit BatchReader(bool use_uring = true, unsigned depth = 64, binDeserialization::Mode mode = binDeserialization::Mode::Default)
+            : ring(use_uring ? depth : 0), mode_(mode) {}
+
+        /* obj must stay alive until Run() returns */
+        template <typename T>
+        void Add(T &obj, const string &path) {
+            Job job;
+            job.path = path;
+            binDeserialization::Mode mode = mode_;
+            job.decode = [&obj, mode](const char *data, size_t len) {
+                binDeserialization::BinaryReader buf(data, len, mode);
+                binDeserialization::DeserializeTo(obj, buf);
+            };
+            jobs.push_back(std::move(job));
+        }
+        bool UsesUring() const {
+            return ring.Ready();
+        }
+        /* reads and decodes every added file; one status per Add, 0 or
+           -errno, with -EBADMSG for files that fail to decode */
+        std::vector<int> Run() {
+#ifdef BIN_HAVE_IO_URING
+            std::vector<int> status = ring.Ready() ? ReadUring() : ReadPlain();
+#else
+            std::vector<int> status = ReadPlain();
+#endif
+            for(size_t i = 0; i < jobs.size(); i++) {
+                if(status[i])
+                    continue;
+                try {
+                    jobs[i].decode(jobs[i].bytes.data(), jobs[i].bytes.size());
+                } catch(const std::exception&) {
+                    status[i] = -EBADMSG;
+                }
+            }
+            jobs.clear();
+            return status;
+        }
+    };
+}  // namespace des
+
+#endif
@@ -8,8 +8,10 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <type_traits>
 
+#include <array>
 #include <list>
 #include <map>
 #include <set>
@@ -23,11 +25,12 @@ namespace xmlSerialization {
     class xmlSerialization
     {
       private:
-        XMLDocument xmldoc;
+        std::unique_ptr<XMLDocument> owned;
+        XMLDocument &xmldoc;
         const char *path;
         XMLElement *xmlroot;
-      public:
-        xmlSerialization(const char *Path) : path(Path) {
+
+        void Open() {
             if(xmldoc.LoadFile(path)) {
                 fstream FILE(path);
                 FILE.close();
@@ -43,6 +46,14 @@ namespace xmlSerialization {
                 xmlroot = xmldoc.FirstChildElement();
             }
         }
+      public:
+        xmlSerialization(const char *Path) : owned(new XMLDocument), xmldoc(*owned), path(Path) {
+            Open();
+        }
+        /* reuses a caller-owned document, e.g. one per worker thread */
+        xmlSerialization(const char *Path, XMLDocument &doc) : xmldoc(doc), path(Path) {
+            Open();
+        }
         XMLElement* GetXmlRoot() {
             return xmlroot;
         }
@@ -87,6 +98,27 @@ namespace xmlSerialization {
             for (auto& item : obj)
                 SerializeFrom(item, "vector_elem", new_node);
         }
+        /* array */
+        template <typename T, size_t N>
+        void SerializeFrom(const std::array<T, N> &obj, const string &node, XMLElement *parent) {
+            XMLElement *new_node = xmldoc.NewElement(node.c_str());
+            new_node->SetAttribute("size", static_cast<unsigned>(N));
+            parent->InsertEndChild(new_node);
+            for (auto& item : obj)
+                SerializeFrom(item, "array_elem", new_node);
+        }
+        /* tuple */
+        template <typename... Ts, size_t... I>
+        void SerializeTuple(const std::tuple<Ts...> &obj, XMLElement *parent, std::index_sequence<I...>) {
+            int arr[] = {0, (SerializeFrom(std::get<I>(obj), "tuple_elem", parent), 0)...};
+            (void)arr;
+        }
+        template <typename... Ts>
+        void SerializeFrom(const std::tuple<Ts...> &obj, const string &node, XMLElement *parent) {
+            XMLElement *new_node = xmldoc.NewElement(node.c_str());
+            parent->InsertEndChild(new_node);
+            SerializeTuple(obj, new_node, std::index_sequence_for<Ts...>());
+        }
         /* list */
         template <typename T>
         void SerializeFrom(const std::list<T> &obj, const string &node, XMLElement *parent) {
@@ -137,6 +169,20 @@ namespace xmlSerialization {
             parent->InsertEndChild(new_node);
             SerializeFrom(*obj, "shared_ptr", new_node);
         }
+        /* user defined type declared with SERIALIZE_FIELDS, one child per field */
+        template <typename T, typename Tuple, size_t... I>
+        void SerializeFields(const T &obj, const Tuple &members, XMLElement *parent, std::index_sequence<I...>) {
+            const char *const *names = binSerialization::Fields<T>::names();
+            int arr[] = {0, (SerializeFrom(obj.*std::get<I>(members), names[I], parent), 0)...};
+            (void)arr;
+        }
+        template <typename T>
+        FIELDS_TYPE SerializeFrom(const T &obj, const string &node, XMLElement *parent) {
+            XMLElement *new_node = xmldoc.NewElement(node.c_str());
+            parent->InsertEndChild(new_node);
+            typedef binSerialization::Fields<T> Members;
+            SerializeFields(obj, Members::members(), new_node, std::make_index_sequence<std::tuple_size<decltype(Members::members())>::value>());
+        }
     };
 }  // namespace xmlSerialization
 
@@ -200,6 +246,26 @@ namespace xmlDeserialization {
                 next_child = next_child->NextSiblingElement();
             }
         }
+        /* array */
+        template <typename T, size_t N>
+        void DeserializeTo(std::array<T, N> &obj, XMLElement *first_elem) {
+            XMLElement *next_child = first_elem->FirstChildElement("array_elem");
+            for(auto& item : obj) {
+                DeserializeTo(item, next_child);
+                next_child = next_child->NextSiblingElement();
+            }
+        }
+        /* tuple */
+        template <typename... Ts, size_t... I>
+        void DeserializeTuple(std::tuple<Ts...> &obj, XMLElement *first_elem, std::index_sequence<I...>) {
+            XMLElement *next_child = first_elem->FirstChildElement("tuple_elem");
+            int arr[] = {0, (DeserializeTo(std::get<I>(obj), next_child), next_child = next_child->NextSiblingElement(), 0)...};
+            (void)arr;
+        }
+        template <typename... Ts>
+        void DeserializeTo(std::tuple<Ts...> &obj, XMLElement *first_elem) {
+            DeserializeTuple(obj, first_elem, std::index_sequence_for<Ts...>());
+        }
         /* list */
         template <typename T>
         void DeserializeTo(std::list<T> &obj, XMLElement *first_elem) {
@@ -224,7 +290,7 @@ namespace xmlDeserialization {
             {
                 T item;
                 DeserializeTo(item, next_child);
-                obj.insert(item);
+                obj.emplace_hint(obj.end(), std::move(item));
                 next_child = next_child->NextSiblingElement();
             }
         }
@@ -239,7 +305,7 @@ namespace xmlDeserialization {
                 T2 item2;
                 DeserializeTo(item1, next_child->FirstChildElement("first"));
                 DeserializeTo(item2, next_child->FirstChildElement("first")->NextSiblingElement("second"));
-                obj.insert({item1, item2});
+                obj.emplace_hint(obj.end(), std::move(item1), std::move(item2));
                 next_child = next_child->NextSiblingElement();
             }
         }
@@ -265,6 +331,18 @@ namespace xmlDeserialization {
             obj = std::shared_ptr<T>(new T);
             DeserializeTo(*obj, first_elem);
         }
+        /* user defined type declared with SERIALIZE_FIELDS */
+        template <typename T, typename Tuple, size_t... I>
+        void DeserializeFields(T &obj, const Tuple &members, XMLElement *first_elem, std::index_sequence<I...>) {
+            const char *const *names = binSerialization::Fields<T>::names();
+            int arr[] = {0, (DeserializeTo(obj.*std::get<I>(members), first_elem->FirstChildElement(names[I])), 0)...};
+            (void)arr;
+        }
+        template <typename T>
+        FIELDS_TYPE DeserializeTo(T &obj, XMLElement *first_elem) {
+            typedef binSerialization::Fields<T> Members;
+            DeserializeFields(obj, Members::members(), first_elem, std::make_index_sequence<std::tuple_size<decltype(Members::members())>::value>());
+        }
     };
 }  // namespace xmlDeserialization
 